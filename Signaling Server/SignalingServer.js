@@ -23,6 +23,8 @@ const MessageType = Object.freeze({
     register: "register",
     offer: "offer",
     answer: "answer",
+    candidate: "candidate",
+    hangup: "hangup",
 });
 
 // Listen for client connections
@@ -61,6 +63,28 @@ socketServer.on('connection', (socket) => {
                 }
                 break;
 
+            case MessageType.candidate:
+                let target = clients.get(data.targetId);
+                if (target) {
+                    target.emit('message', JSON.stringify({
+                        type: MessageType.candidate,
+                        MyId: data.MyId,
+                        candidate: data.candidate,
+                        sdpMid: data.sdpMid
+                    }));
+                }
+                break;
+
+            case MessageType.hangup:
+                let peer = clients.get(data.targetId);
+                if (peer) {
+                    peer.emit('message', JSON.stringify({
+                        type: MessageType.hangup,
+                        MyId: data.MyId
+                    }));
+                }
+                break;
+
             default:
                 console.log("ERROR: Unknown message type");
         }
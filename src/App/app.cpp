@@ -3,27 +3,31 @@
 App::App(QObject *parent, bool isOfferer)
     : QObject{parent}
 {
+    // One client for the lifetime of the app: it stays registered with the
+    // signaling server and keeps the audio devices open between calls.
     if (isOfferer)
+    {
         m_verName = "Offerer";
+        client = new Client(this, "https://localhost:8080", "peer1", true, "peer2");
+    }
     else
     {
         m_verName = "Answerer";
-        client = new Client(nullptr, "https://localhost:8080", "peer2", false, "peer1");
+        client = new Client(this, "https://localhost:8080", "peer2", false, "peer1");
     }
     this->isOfferer = isOfferer;
+    connect(client, &Client::callEnded, this, &App::callEnded);
 }
 
 void App::start()
 {
     if (isOfferer)
     {
-        client = new Client(nullptr, "https://localhost:8080", "peer1", true, "peer2");
         client->startCall("peer2");
     }
 }
 
 void App::end()
 {
-    delete client;
-    client = nullptr;
+    client->endCall();
 }
@@ -15,6 +15,8 @@ public:
 
 Q_SIGNALS:
     void verNameChanged();
+    // The previous call is fully torn down; end() returns before that.
+    void callEnded();
 private:
     QString m_verName;
     bool isOfferer;
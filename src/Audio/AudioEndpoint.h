@@ -0,0 +1,37 @@
+#ifndef AUDIOENDPOINT_H
+#define AUDIOENDPOINT_H
+
+class AudioInput;
+class PlayoutDevice;
+
+/**
+ * Where AudioInput gets its audio from: the sound card by default
+ * (DeviceCapture), or a file for runs without sound hardware
+ * (FileCapture). Between start() and stop() the endpoint writes PCM in
+ * the input's format() into the input, from whatever thread it likes.
+ */
+class CaptureEndpoint
+{
+public:
+    virtual ~CaptureEndpoint() = default;
+
+    virtual bool start(AudioInput *input) = 0;
+    virtual void stop() = 0;
+};
+
+/**
+ * Where decoded audio goes: the sound card (DevicePlayback), a file
+ * (FilePlayback) or nowhere (NullPlayback). Between start() and stop()
+ * the endpoint reads the device on its own clock; every read decodes
+ * just in time, so the endpoint's clock is the playout clock.
+ */
+class PlaybackEndpoint
+{
+public:
+    virtual ~PlaybackEndpoint() = default;
+
+    virtual bool start(PlayoutDevice *device) = 0;
+    virtual void stop() = 0;
+};
+
+#endif
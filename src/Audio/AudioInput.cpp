@@ -1,19 +1,45 @@
 #include "AudioInput.h"
+#include <algorithm>
+#include "Audio/DeviceEndpoint.h"
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(Q_OS_MAC)
+#include <pthread.h>
+#include <pthread/qos.h>
+#endif
+
+// QThread::TimeCriticalPriority is enough on Windows. On Linux it is a no-op
+// under SCHED_OTHER, so ask for SCHED_FIFO explicitly (needs CAP_SYS_NICE or
+// an rtprio limit); on macOS use the highest QoS class instead.
+static void raiseEncoderThreadPriority()
+{
+#if defined(Q_OS_LINUX)
+    sched_param param{};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        qDebug() << "Encoder thread: real-time scheduling not permitted, using normal priority";
+    }
+#elif defined(Q_OS_MAC)
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#endif
+}
 
 AudioInput::AudioInput(QObject *parent)
-    :opusEncoder(nullptr), sampleRate(48000), channels(1) {
+    :PipelineStage("capture"), capturing(false), rate(48000), channels(1), frameDurationUs(20000),
+    encoderThread(nullptr), encoderRunning(false), lastChunkSamples(0),
+    overrunCount(0), missedDeadlineCount(0), droppedSamples(0),
+    framePool(FramePoolSize, int(qint64(rate) * MaxFrameDurationUs / 1000000) * channels),
+    samplePosition(0), droppedSamplesSeen(0) {
 
-    QAudioFormat format;
-    format.setSampleRate(sampleRate);
-    format.setChannelCount(channels);
-    format.setSampleFormat(QAudioFormat::Int16);
-    qAudioSource = new QAudioSource(format, this);
+    audioFormat.setSampleRate(rate);
+    audioFormat.setChannelCount(channels);
+    audioFormat.setSampleFormat(QAudioFormat::Int16);
+    capture = std::make_unique<DeviceCapture>(audioFormat);
 
-    int error;
-    opusEncoder = opus_encoder_create(sampleRate, channels, OPUS_APPLICATION_AUDIO, &error);
-    if (error != OPUS_OK) {
-        qDebug() << "Failed to create Opus encoder:" << opus_strerror(error);
-    }
+    const int maxFrameLength = int(qint64(rate) * MaxFrameDurationUs / 1000000) * channels;
+    captureRing.reset(maxFrameLength * CaptureRingFrames);
 
     this->open(QIODevice::WriteOnly);
     if (!this->isOpen()) {
@@ -21,35 +47,132 @@ AudioInput::AudioInput(QObject *parent)
     }
 }
 
+AudioInput::~AudioInput() {
+    stop();
+}
+
 void AudioInput::start() {
-    qAudioSource->start(this);
-    if (qAudioSource->state() != QAudio::ActiveState) {
-        qDebug() << "Audio source not active. State:" << qAudioSource->state();
+    if (!encoderThread) {
+        encoderRunning.store(true, std::memory_order_release);
+        encoderThread = QThread::create([this] { encodeLoop(); });
+        encoderThread->setObjectName("OpusEncoder");
+        encoderThread->start(QThread::TimeCriticalPriority);
+    }
+
+    if (!capturing) {
+        capturing = capture->start(this);
+    }
+}
+
+void AudioInput::stop() {
+    capture->stop();
+    capturing = false;
+
+    if (encoderThread) {
+        encoderRunning.store(false, std::memory_order_release);
+        captureSignal.release();
+        encoderThread->wait();
+        delete encoderThread;
+        encoderThread = nullptr;
     }
+
+    // Both sides of the ring are idle now. The next call must not start
+    // with what was left of this one's last frame.
+    captureRing.discard(captureRing.readAvailable());
+    captureSignal.tryAcquire(captureSignal.available());
+}
+
+void AudioInput::setCaptureEndpoint(std::unique_ptr<CaptureEndpoint> endpoint) {
+    if (!endpoint) {
+        return;
+    }
+
+    capture->stop();
+    capture = std::move(endpoint);
+    if (capturing) {
+        capturing = capture->start(this);
+    }
+}
+
+bool AudioInput::setFrameDuration(int microseconds) {
+    if (!EncoderProfile::isValidFrameDuration(microseconds)) {
+        qDebug() << "Rejected invalid frame duration:" << microseconds << "us";
+        return false;
+    }
+    frameDurationUs.store(microseconds, std::memory_order_relaxed);
+    return true;
 }
 
 qint64 AudioInput::writeData(const char *data, qint64 len) {
-    qDebug() << "Received audio data of size:" << len;
-    QByteArray encodedData = encodeData(data, len);
-    Q_EMIT dataReady(encodedData);
+    // Runs on the capture callback: only hand the PCM over, never encode here.
+    const qint16 *pcm = reinterpret_cast<const qint16 *>(data);
+    const std::size_t samples = std::size_t(len / qint64(sizeof(qint16)));
+
+    // Drop the whole chunk rather than a torn part of it when the pipeline
+    // thread cannot keep up.
+    if (captureRing.writeAvailable() < samples) {
+        overrunCount.fetch_add(1, std::memory_order_relaxed);
+        droppedSamples.fetch_add(samples / std::size_t(channels), std::memory_order_relaxed);
+    } else {
+        captureRing.write(pcm, samples);
+    }
+    lastChunkSamples.store(int(samples), std::memory_order_relaxed);
+    captureSignal.release();
+
     return len;
 }
 
-QByteArray AudioInput::encodeData(const char *data, qint64 len) {
-    const int maxPacketSize = 4000;
-    QByteArray encodedData(maxPacketSize, 0);
+void AudioInput::encodeLoop() {
+    raiseEncoderThreadPriority();
+
+    while (true) {
+        captureSignal.acquire();
+        captureSignal.tryAcquire(captureSignal.available());
+        if (!encoderRunning.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        // The ring accumulates partial periods; push every complete frame.
+        const int frameSize = frameSamples();
+        const std::size_t frameLength = std::size_t(frameSize * channels);
+        while (captureRing.readAvailable() >= frameLength) {
+            // Anything queued beyond one capture period and this frame means
+            // the pipeline has fallen behind real time.
+            const std::size_t slack = std::max<std::size_t>(frameLength, lastChunkSamples.load(std::memory_order_relaxed));
+            const bool late = captureRing.readAvailable() > frameLength + slack;
+
+            // Dropped capture chunks still took real time; keep the sample
+            // position, and with it the RTP timestamp, in step with it.
+            const quint64 dropped = droppedSamples.load(std::memory_order_relaxed);
+            samplePosition += dropped - droppedSamplesSeen;
+            droppedSamplesSeen = dropped;
 
-    const opus_int16 *pcmData = reinterpret_cast<const opus_int16 *>(data);
-    int encodedBytes = opus_encode(opusEncoder, pcmData, len / sizeof(opus_int16),
-                                   reinterpret_cast<unsigned char *>(encodedData.data()),
-                                   maxPacketSize);
+            const qint64 startNs = clockNs();
+            pushFrame(frameSize);
+            samplePosition += quint64(frameSize);
 
-    if (encodedBytes < 0) {
-        qDebug() << "Opus encoding error:" << opus_strerror(encodedBytes);
-        return QByteArray();
+            if (late || (clockNs() - startNs) / 1000 > frameDuration()) {
+                missedDeadlineCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
     }
+}
+
+void AudioInput::pushFrame(int frameSize) {
+    const std::size_t frameLength = std::size_t(frameSize * channels);
+
+    run([&] {
+        FrameRef<qint16> frame = framePool.acquire();
+        if (!frame) {
+            captureRing.discard(frameLength);
+            return;
+        }
 
-    encodedData.resize(encodedBytes);
-    qDebug() << "Encoded data size:" << encodedBytes;
-    return encodedData;
+        captureRing.read(frame->data(), frameLength);
+        frame->setSize(int(frameLength));
+        frame->samplePosition = samplePosition;
+        frame->frameSamples = frameSize;
+        frame->captureUs = clockNs() / 1000;
+        pcmOutput.push(frame);
+    });
 }
@@ -1,27 +1,96 @@
 #ifndef AUDIOINPUT_H
 #define AUDIOINPUT_H
-#include <QAudioSource>
+#include <QAudioFormat>
 #include <QIODevice>
 #include <QDebug>
-#include "opus.h"
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include "Audio/AudioEndpoint.h"
+#include "Audio/EncoderProfile.h"
+#include "Pipeline/PipelinePort.h"
+#include "Utils/SpscRingBuffer.h"
 
-class AudioInput : public QIODevice{
+// Source of the send pipeline: cuts the captured audio into frames on its
+// own thread and pushes them into output(). Everything connected behind it
+// (encoder, sender, ...) runs on that thread.
+class AudioInput : public QIODevice, public PipelineStage {
     Q_OBJECT
 public:
+    // Opus only accepts 2.5, 5, 10, 20, 40 and 60 ms frames.
+    static constexpr int MaxFrameDurationUs = 60000;
+    // How much captured audio may queue up in front of the pipeline thread.
+    static constexpr int CaptureRingFrames = 8;
+    // PCM frames the pipeline can hold on to at once.
+    static constexpr int FramePoolSize = 4;
+
     explicit AudioInput(QObject *parent = nullptr);
+    ~AudioInput();
     qint64 writeData (const char* data, qint64 len);
     qint64 readData(char *data, qint64 maxlen){return 0;};
     void close(){return;};
     bool seek(qint64 pos){return 0;};
     void start();
-    QByteArray encodeData(const char* data, qint64 len);
-Q_SIGNALS:
-    void dataReady(QByteArray &data);
+    void stop();
+
+    // Connect the stages behind the capture before start().
+    OutputPort<qint16> &output() { return pcmOutput; }
+
+    // Replaces the microphone (a DeviceCapture by default), e.g. with a
+    // FileCapture. A running capture moves over to the new endpoint.
+    void setCaptureEndpoint(std::unique_ptr<CaptureEndpoint> endpoint);
+    // What the capture endpoint has to write.
+    QAudioFormat format() const { return audioFormat; }
+    // Bytes writeData() can take right now without dropping audio.
+    qint64 writeSpace() const { return qint64(captureRing.writeAvailable() * sizeof(qint16)); }
+
+    int sampleRate() const { return rate; }
+    int channelCount() const { return channels; }
+
+    // Picked up before the next frame; keep it equal to the encoder's
+    // profile (see EncoderProfile::frameDurationUs).
+    bool setFrameDuration(int microseconds);
+    int frameDuration() const { return frameDurationUs.load(std::memory_order_relaxed); }
+    int frameSamples() const { return int(qint64(rate) * frameDuration() / 1000000); }
+
+    // Capture chunks that did not fit into the ring because the pipeline
+    // thread fell behind.
+    quint64 overruns() const { return overrunCount.load(std::memory_order_relaxed); }
+    // Frames that went through the pipeline later than one frame duration
+    // after they became available.
+    quint64 missedDeadlines() const { return missedDeadlineCount.load(std::memory_order_relaxed); }
+    // Frames dropped because the pipeline still held every pooled frame.
+    quint64 droppedFrames() const { return framePool.exhausted(); }
+
 private:
-    QAudioSource * qAudioSource;
-    OpusEncoder *opusEncoder;
-    int sampleRate;
+    void encodeLoop();
+    void pushFrame(int frameSize);
+
+    std::unique_ptr<CaptureEndpoint> capture;
+    QAudioFormat audioFormat;
+    bool capturing;
+    int rate;
     int channels;
+    std::atomic<int> frameDurationUs;
+
+    // Capture callback -> pipeline thread. Sized for CaptureRingFrames of the
+    // longest Opus frame so it never grows at runtime.
+    SpscRingBuffer<qint16> captureRing;
+    QSemaphore captureSignal;
+    QThread *encoderThread;
+    std::atomic<bool> encoderRunning;
+    std::atomic<int> lastChunkSamples;
+    std::atomic<quint64> overrunCount;
+    std::atomic<quint64> missedDeadlineCount;
+    std::atomic<quint64> droppedSamples;
+
+    FramePool<qint16> framePool;
+    OutputPort<qint16> pcmOutput;
+
+    // Owned by the pipeline thread.
+    quint64 samplePosition;
+    quint64 droppedSamplesSeen;
 };
 
 #endif
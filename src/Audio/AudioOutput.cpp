@@ -1,46 +1,43 @@
 #include "AudioOutput.h"
 #include <QDebug>
+#include "Audio/DeviceEndpoint.h"
 
 AudioOutput::AudioOutput(QObject *parent)
-    : QObject(parent), opusDecoder(nullptr) {
+    : QObject(parent) {
 
 
     audioFormat.setSampleRate(48000);
     audioFormat.setChannelCount(1);
     audioFormat.setSampleFormat(QAudioFormat::Int16);
-    audioSink = new QAudioSink(QMediaDevices::defaultAudioOutput(), audioFormat, this);
-    audioDevice = audioSink->start();
 
-    int error;
-    opusDecoder = opus_decoder_create(audioFormat.sampleRate(), audioFormat.channelCount(), &error);
-    if (error != OPUS_OK) {
-        qDebug() << "Failed to create Opus decoder:" << opus_strerror(error);
-    }
+    playoutDevice = new PlayoutDevice(audioFormat.sampleRate(), audioFormat.channelCount(), this);
+    playoutDevice->open(QIODevice::ReadOnly);
+
+    playback = std::make_unique<DevicePlayback>(audioFormat, SinkBufferMs);
+    playback->start(playoutDevice);
 
-    connect(this, &AudioOutput::newPacket, this, &AudioOutput::play);
+    arrivalClock.start();
 }
 
-void AudioOutput::addData(const QByteArray &data) {
-    QMutexLocker locker(&mutex);
-    audioQueue.enqueue(data);
-    Q_EMIT newPacket();
+AudioOutput::~AudioOutput() {
+    playback->stop();
 }
 
-void AudioOutput::play() {
-    while (!audioQueue.isEmpty()) {
-        QByteArray audioData = audioQueue.dequeue();
+void AudioOutput::setPlaybackEndpoint(std::unique_ptr<PlaybackEndpoint> endpoint) {
+    if (!endpoint) {
+        return;
+    }
 
-        opus_int16 pcmData[960];
-        int decodedSamples = opus_decode(opusDecoder, reinterpret_cast<const unsigned char *>(audioData.data()),
-                                         audioData.size(), pcmData, 960, 0);
+    playback->stop();
+    playback = std::move(endpoint);
+    playback->start(playoutDevice);
+}
 
-        if (decodedSamples < 0) {
-            qDebug() << "Opus decoding error:" << opus_strerror(decodedSamples);
-            continue;
-        }
+void AudioOutput::addData(quint32 ssrc, const QByteArray &data, quint16 sequenceNumber, quint32 timestamp) {
+    frameReceived(ssrc, reinterpret_cast<const unsigned char *>(data.constData()), data.size(), sequenceNumber, timestamp);
+}
 
-        if (audioDevice) {
-            audioDevice->write(reinterpret_cast<const char *>(pcmData), decodedSamples * sizeof(opus_int16));
-        }
-    }
+void AudioOutput::frameReceived(quint32 ssrc, const unsigned char *payload, int size, quint16 sequenceNumber, quint32 timestamp) {
+    playoutDevice->addPacket(ssrc, reinterpret_cast<const char *>(payload), size, sequenceNumber, timestamp,
+                             arrivalClock.nsecsElapsed() / 1000);
 }
@@ -3,33 +3,43 @@
 
 #include <QObject>
 #include <QAudioFormat>
-#include <QAudioSink>
-#include <QMediaDevices>
-#include <QMutex>
-#include <QQueue>
+#include <QElapsedTimer>
 #include <QByteArray>
-#include <opus.h>
+#include <memory>
+#include "Audio/AudioEndpoint.h"
+#include "Audio/PlayoutDevice.h"
+#include "Audio/ReceivedFrameSink.h"
 
-class AudioOutput : public QObject {
+class AudioOutput : public QObject, public ReceivedFrameSink {
     Q_OBJECT
 
 public:
+    // Device buffer the sink pulls ahead of the speaker.
+    static constexpr int SinkBufferMs = 40;
+
     explicit AudioOutput(QObject *parent = nullptr);
-    void addData(const QByteArray &data);
+    ~AudioOutput();
+    void addData(quint32 ssrc, const QByteArray &data, quint16 sequenceNumber, quint32 timestamp);
+    // ReceivedFrameSink: the network thread hands payloads straight to the
+    // queue of the sender's stream in the playout device.
+    void frameReceived(quint32 ssrc, const unsigned char *payload, int size, quint16 sequenceNumber, quint32 timestamp) override;
+    // Between calls: the next streams start with empty jitter buffers
+    // while the sink and decoders stay open.
+    void reset() { playoutDevice->reset(); }
 
-Q_SIGNALS:
-    void newPacket();
+    PlayoutStats stats() const { return playoutDevice->stats(); }
 
-private Q_SLOTS:
-    void play();
+    // Replaces the speaker (a DevicePlayback by default), e.g. with a
+    // FilePlayback or NullPlayback, and starts it.
+    void setPlaybackEndpoint(std::unique_ptr<PlaybackEndpoint> endpoint);
+    // What the playback endpoint receives.
+    QAudioFormat format() const { return audioFormat; }
 
 private:
-    QAudioSink *audioSink;
-    QIODevice *audioDevice;
+    std::unique_ptr<PlaybackEndpoint> playback;
+    PlayoutDevice *playoutDevice;
     QAudioFormat audioFormat;
-    QMutex mutex;
-    QQueue<QByteArray> audioQueue;
-    OpusDecoder *opusDecoder;
+    QElapsedTimer arrivalClock;
 };
 
 #endif
@@ -0,0 +1,101 @@
+#include "DeviceEndpoint.h"
+#include <QDebug>
+#include <QMediaDevices>
+#include <utility>
+#include "Audio/AudioInput.h"
+#include "Audio/PlayoutDevice.h"
+
+/**
+ * ====================================================
+ * =================== DeviceCapture ==================
+ * ====================================================
+ */
+
+DeviceCapture::DeviceCapture(const QAudioFormat &format)
+    : m_source(new QAudioSource(format))
+{
+}
+
+DeviceCapture::~DeviceCapture()
+{
+    m_source->stop();
+    delete m_source;
+}
+
+bool DeviceCapture::start(AudioInput *input)
+{
+    m_source->start(input);
+    if (m_source->state() != QAudio::ActiveState) {
+        qDebug() << "Audio source not active. State:" << m_source->state();
+        return false;
+    }
+    return true;
+}
+
+void DeviceCapture::stop()
+{
+    m_source->stop();
+}
+
+/**
+ * ====================================================
+ * ================== DevicePlayback ==================
+ * ====================================================
+ */
+
+template <typename Function>
+void DevicePlayback::runOnPlaybackThread(Function &&function)
+{
+    QMetaObject::invokeMethod(m_context, std::forward<Function>(function), Qt::BlockingQueuedConnection);
+}
+
+DevicePlayback::DevicePlayback(const QAudioFormat &format, int bufferMs)
+    : m_thread(new QThread),
+    m_context(new QObject)
+{
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+
+    m_thread->setObjectName("DevicePlayback");
+    m_context->moveToThread(m_thread);
+    m_thread->start(QThread::TimeCriticalPriority);
+
+    runOnPlaybackThread([this, device, format, bufferMs] {
+        m_sink = new QAudioSink(device, format);
+        m_sink->setBufferSize(format.bytesForDuration(qint64(bufferMs) * 1000));
+    });
+}
+
+DevicePlayback::~DevicePlayback()
+{
+    // The sink goes on the thread that owns it, before its event loop ends.
+    runOnPlaybackThread([this] {
+        m_sink->stop();
+        delete m_sink;
+        m_sink = nullptr;
+    });
+
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+    delete m_thread;
+}
+
+bool DevicePlayback::start(PlayoutDevice *device)
+{
+    // Pull mode: the sink asks the playout device for audio on its own
+    // schedule and decoding happens inside that request, on m_thread.
+    bool started = false;
+    runOnPlaybackThread([this, device, &started] {
+        m_sink->start(device);
+        started = m_sink->state() != QAudio::StoppedState;
+        if (!started) {
+            qDebug() << "Audio sink failed to start:" << m_sink->error();
+        }
+    });
+    return started;
+}
+
+void DevicePlayback::stop()
+{
+    runOnPlaybackThread([this] { m_sink->stop(); });
+}
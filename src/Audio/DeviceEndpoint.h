@@ -0,0 +1,51 @@
+#ifndef DEVICEENDPOINT_H
+#define DEVICEENDPOINT_H
+
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QAudioSource>
+#include <QObject>
+#include <QThread>
+#include "Audio/AudioEndpoint.h"
+
+// Default input device through QAudioSource.
+class DeviceCapture : public CaptureEndpoint
+{
+public:
+    explicit DeviceCapture(const QAudioFormat &format);
+    ~DeviceCapture();
+
+    bool start(AudioInput *input) override;
+    void stop() override;
+
+private:
+    QAudioSource   *m_source;
+};
+
+/**
+ * Default output device through QAudioSink, in pull mode. Qt's backends
+ * call the device's readData() from a timer on the thread that owns the
+ * sink, so the sink lives on a thread of its own with its own event loop:
+ * decoding and concealment never wait for the GUI thread.
+ */
+class DevicePlayback : public PlaybackEndpoint
+{
+public:
+    // bufferMs: device buffer the sink pulls ahead of the speaker.
+    DevicePlayback(const QAudioFormat &format, int bufferMs);
+    ~DevicePlayback();
+
+    bool start(PlayoutDevice *device) override;
+    void stop() override;
+
+private:
+    // Runs function on the playback thread and waits for it.
+    template <typename Function>
+    void runOnPlaybackThread(Function &&function);
+
+    QThread        *m_thread;
+    QObject        *m_context;      // lives on m_thread
+    QAudioSink     *m_sink = nullptr;
+};
+
+#endif
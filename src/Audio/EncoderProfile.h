@@ -0,0 +1,103 @@
+#ifndef ENCODERPROFILE_H
+#define ENCODERPROFILE_H
+
+#include <QString>
+#include "opus.h"
+
+/**
+ * Opus encoder settings that can be switched on a running AudioInput
+ * through opus_encoder_ctl, without recreating the encoder.
+ */
+struct EncoderProfile
+{
+    int application = OPUS_APPLICATION_AUDIO;
+    int frameDurationUs = 20000;                // 2500, 5000, 10000, 20000, 40000 or 60000
+    int complexity = 10;                        // 0 (fastest) .. 10 (best quality)
+    int maxBandwidth = OPUS_BANDWIDTH_FULLBAND;
+    int signal = OPUS_AUTO;                     // OPUS_AUTO, OPUS_SIGNAL_VOICE or OPUS_SIGNAL_MUSIC
+    int bitrate = 48000;                        // bits per second, or OPUS_AUTO
+    bool inbandFec = false;                     // LBRR copy of the previous frame for the receiver's FEC decode
+    bool dtx = false;                           // discontinuous transmission during silence
+
+    // General purpose default, tuned for music quality.
+    static EncoderProfile music() { return EncoderProfile(); }
+
+    static EncoderProfile voice()
+    {
+        EncoderProfile profile;
+        profile.application = OPUS_APPLICATION_VOIP;
+        profile.maxBandwidth = OPUS_BANDWIDTH_WIDEBAND;
+        profile.signal = OPUS_SIGNAL_VOICE;
+        profile.bitrate = 32000;
+        profile.inbandFec = true;
+        profile.dtx = true;
+        return profile;
+    }
+
+    // CELT only, no lookahead, short frames.
+    static EncoderProfile lowLatency()
+    {
+        EncoderProfile profile;
+        profile.application = OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+        profile.frameDurationUs = 5000;
+        profile.complexity = 8;
+        profile.bitrate = 64000;
+        return profile;
+    }
+
+    static EncoderProfile lowCpu()
+    {
+        EncoderProfile profile = voice();
+        profile.complexity = 1;
+        profile.bitrate = 24000;
+        return profile;
+    }
+
+    // The profile called music, voice, low-latency or low-cpu, as named on
+    // the command line. False for any other name.
+    static bool fromName(const QString &name, EncoderProfile *profile)
+    {
+        if (name == "music") {
+            *profile = music();
+        } else if (name == "voice") {
+            *profile = voice();
+        } else if (name == "low-latency") {
+            *profile = lowLatency();
+        } else if (name == "low-cpu") {
+            *profile = lowCpu();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool isValidFrameDuration(int microseconds)
+    {
+        switch (microseconds) {
+        case 2500:
+        case 5000:
+        case 10000:
+        case 20000:
+        case 40000:
+        case 60000:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool isValid() const
+    {
+        const bool validApplication = application == OPUS_APPLICATION_VOIP
+                                      || application == OPUS_APPLICATION_AUDIO
+                                      || application == OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+        const bool validSignal = signal == OPUS_AUTO || signal == OPUS_SIGNAL_VOICE || signal == OPUS_SIGNAL_MUSIC;
+        const bool validBandwidth = maxBandwidth >= OPUS_BANDWIDTH_NARROWBAND && maxBandwidth <= OPUS_BANDWIDTH_FULLBAND;
+        const bool validBitrate = bitrate == OPUS_AUTO || (bitrate >= 500 && bitrate <= 512000);
+
+        return validApplication && isValidFrameDuration(frameDurationUs) && validSignal && validBandwidth && validBitrate
+               && complexity >= 0 && complexity <= 10;
+    }
+};
+
+#endif
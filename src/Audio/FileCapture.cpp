@@ -0,0 +1,182 @@
+#include "FileCapture.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "Audio/AudioInput.h"
+
+static quint32 readLittleEndian(const char *data, int size)
+{
+    quint32 value = 0;
+    for (int i = size - 1; i >= 0; --i)
+        value = (value << 8) | quint8(data[i]);
+    return value;
+}
+
+// Finds the PCM data of a RIFF/WAVE file and checks that it is 16-bit
+// integer PCM in the expected format.
+static bool readWavHeader(QFile &file, const QAudioFormat &format, qint64 *dataOffset, qint64 *dataSize)
+{
+    char riff[12];
+    if (file.read(riff, 12) != 12 || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        qWarning() << "Not a RIFF/WAVE file:" << file.fileName();
+        return false;
+    }
+
+    bool hasFormat = false;
+    char chunk[8];
+    while (file.read(chunk, 8) == 8) {
+        const qint64 chunkSize = readLittleEndian(chunk + 4, 4);
+        const qint64 chunkStart = file.pos();
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            char fmt[16];
+            if (chunkSize < 16 || file.read(fmt, 16) != 16) {
+                break;
+            }
+            const int audioFormat = int(readLittleEndian(fmt, 2));
+            const int channels = int(readLittleEndian(fmt + 2, 2));
+            const int sampleRate = int(readLittleEndian(fmt + 4, 4));
+            const int bitsPerSample = int(readLittleEndian(fmt + 14, 2));
+            if (audioFormat != 1 || bitsPerSample != 16 || channels != format.channelCount()
+                || sampleRate != format.sampleRate()) {
+                qWarning() << "WAV file" << file.fileName() << "is" << sampleRate << "Hz," << channels << "channels,"
+                           << bitsPerSample << "bit; expected" << format.sampleRate() << "Hz,"
+                           << format.channelCount() << "channels, 16 bit PCM";
+                return false;
+            }
+            hasFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!hasFormat) {
+                break;
+            }
+            *dataOffset = chunkStart;
+            *dataSize = std::min(chunkSize, file.size() - chunkStart);
+            return true;
+        }
+
+        // Chunks are padded to an even size.
+        if (!file.seek(chunkStart + chunkSize + (chunkSize & 1))) {
+            break;
+        }
+    }
+
+    qWarning() << "No PCM data in WAV file:" << file.fileName();
+    return false;
+}
+
+FileCapture::FileCapture(const QString &path, const QAudioFormat &format, Pacing pacing, bool loop)
+    : m_path(path),
+    m_format(format),
+    m_pacing(pacing),
+    m_loop(loop)
+{
+}
+
+FileCapture::~FileCapture()
+{
+    stop();
+}
+
+bool FileCapture::openFile()
+{
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open capture file" << m_path << ":" << m_file.errorString();
+        return false;
+    }
+
+    if (QFileInfo(m_path).suffix().compare("wav", Qt::CaseInsensitive) == 0) {
+        if (!readWavHeader(m_file, m_format, &m_dataOffset, &m_dataSize)) {
+            m_file.close();
+            return false;
+        }
+    } else {
+        m_dataOffset = 0;
+        m_dataSize = m_file.size();
+    }
+
+    // Only whole sample frames.
+    m_dataSize -= m_dataSize % m_format.bytesPerFrame();
+    if (m_dataSize <= 0) {
+        qWarning() << "Capture file has no audio:" << m_path;
+        m_file.close();
+        return false;
+    }
+    return m_file.seek(m_dataOffset);
+}
+
+bool FileCapture::start(AudioInput *input)
+{
+    if (m_thread) {
+        return true;
+    }
+    if (!openFile()) {
+        return false;
+    }
+
+    m_finished.store(false, std::memory_order_relaxed);
+    m_running.store(true, std::memory_order_release);
+    m_thread = QThread::create([this, input] { captureLoop(input); });
+    m_thread->setObjectName("FileCapture");
+    m_thread->start();
+    return true;
+}
+
+void FileCapture::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_running.store(false, std::memory_order_release);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_file.close();
+}
+
+void FileCapture::captureLoop(AudioInput *input)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Allocated once; the loop itself does not allocate.
+    QByteArray chunk(m_format.bytesForDuration(qint64(ChunkMs) * 1000), Qt::Uninitialized);
+    qint64 position = 0;
+    Clock::time_point nextChunk = Clock::now();
+
+    while (m_running.load(std::memory_order_acquire)) {
+        if (position == m_dataSize) {
+            if (!m_loop) {
+                m_finished.store(true, std::memory_order_release);
+                qDebug() << "Capture file finished:" << m_path;
+                return;
+            }
+            position = 0;
+            m_file.seek(m_dataOffset);
+        }
+
+        const qint64 bytes = m_file.read(chunk.data(), std::min<qint64>(chunk.size(), m_dataSize - position));
+        if (bytes <= 0) {
+            qWarning() << "Cannot read capture file" << m_path << ":" << m_file.errorString();
+            m_finished.store(true, std::memory_order_release);
+            return;
+        }
+        position += bytes;
+
+        if (m_pacing == Pacing::RealTime) {
+            // A chunk is only available once it has been "recorded".
+            nextChunk += std::chrono::microseconds(m_format.durationForBytes(int(bytes)));
+            std::this_thread::sleep_until(nextChunk);
+        } else {
+            while (input->writeSpace() < bytes && m_running.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        input->write(chunk.constData(), bytes);
+        m_bytesCaptured.fetch_add(quint64(bytes), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FILECAPTURE_H
+#define FILECAPTURE_H
+
+#include <QAudioFormat>
+#include <QFile>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include "Audio/AudioEndpoint.h"
+
+/**
+ * Capture from a WAV or raw PCM file instead of a microphone, for
+ * repeatable runs without sound hardware. A .wav file must already be in
+ * the capture format (no resampling is done); any other file is taken as
+ * raw PCM in that format. The file is read on its own thread in ChunkMs
+ * chunks, either paced like a real device or as fast as the send
+ * pipeline takes them.
+ */
+class FileCapture : public CaptureEndpoint
+{
+public:
+    static constexpr int ChunkMs = 10;
+
+    enum class Pacing {
+        RealTime,
+        AsFastAsPossible    // waits only for room in the capture ring
+    };
+
+    FileCapture(const QString &path, const QAudioFormat &format, Pacing pacing = Pacing::RealTime, bool loop = false);
+    ~FileCapture();
+
+    bool start(AudioInput *input) override;
+    void stop() override;
+
+    // Reached the end of the file, without loop.
+    bool finished() const { return m_finished.load(std::memory_order_acquire); }
+    quint64 bytesCaptured() const { return m_bytesCaptured.load(std::memory_order_relaxed); }
+
+private:
+    bool openFile();
+    void captureLoop(AudioInput *input);
+
+    QString                 m_path;
+    QAudioFormat            m_format;
+    Pacing                  m_pacing;
+    bool                    m_loop;
+    QFile                   m_file;
+    qint64                  m_dataOffset = 0;
+    qint64                  m_dataSize = 0;
+    QThread                *m_thread = nullptr;
+    std::atomic<bool>       m_running{false};
+    std::atomic<bool>       m_finished{false};
+    std::atomic<quint64>    m_bytesCaptured{0};
+};
+
+#endif
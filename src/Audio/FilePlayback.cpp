@@ -0,0 +1,154 @@
+#include "FilePlayback.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "Audio/PlayoutDevice.h"
+
+static constexpr int WavHeaderSize = 44;
+
+static void writeLittleEndian(char *data, quint32 value, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        data[i] = char(value & 0xff);
+        value >>= 8;
+    }
+}
+
+/**
+ * ====================================================
+ * ================= ClockedPlayback ==================
+ * ====================================================
+ */
+
+ClockedPlayback::ClockedPlayback(const QAudioFormat &format)
+    : m_format(format)
+{
+}
+
+ClockedPlayback::~ClockedPlayback()
+{
+    // Too late for consume(), which belongs to the subclass.
+    Q_ASSERT(!m_thread);
+}
+
+bool ClockedPlayback::start(PlayoutDevice *device)
+{
+    if (m_thread) {
+        return true;
+    }
+    if (!open()) {
+        return false;
+    }
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = QThread::create([this, device] { playLoop(device); });
+    m_thread->setObjectName("ClockedPlayback");
+    m_thread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void ClockedPlayback::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_running.store(false, std::memory_order_release);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    close();
+}
+
+void ClockedPlayback::playLoop(PlayoutDevice *device)
+{
+    using Clock = std::chrono::steady_clock;
+
+    QByteArray period(m_format.bytesForDuration(qint64(PeriodMs) * 1000), Qt::Uninitialized);
+    Clock::time_point nextPeriod = Clock::now();
+
+    while (m_running.load(std::memory_order_acquire)) {
+        nextPeriod += std::chrono::milliseconds(PeriodMs);
+        std::this_thread::sleep_until(nextPeriod);
+
+        const qint64 bytes = device->read(period.data(), period.size());
+        if (bytes > 0) {
+            consume(period.constData(), bytes);
+            m_bytesPlayed.fetch_add(quint64(bytes), std::memory_order_relaxed);
+        }
+        if (Clock::now() > nextPeriod + std::chrono::milliseconds(PeriodMs)) {
+            m_lateReads.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * ====================================================
+ * =================== FilePlayback ===================
+ * ====================================================
+ */
+
+FilePlayback::FilePlayback(const QString &path, const QAudioFormat &format)
+    : ClockedPlayback(format),
+    m_path(path),
+    m_isWav(QFileInfo(path).suffix().compare("wav", Qt::CaseInsensitive) == 0)
+{
+}
+
+FilePlayback::~FilePlayback()
+{
+    stop();
+}
+
+bool FilePlayback::open()
+{
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot open playback file" << m_path << ":" << m_file.errorString();
+        return false;
+    }
+
+    // Sizes are filled in by close().
+    if (m_isWav) {
+        writeWavHeader(0);
+    }
+    return true;
+}
+
+void FilePlayback::consume(const char *data, qint64 size)
+{
+    m_file.write(data, size);
+}
+
+void FilePlayback::close()
+{
+    if (m_isWav) {
+        const qint64 dataSize = m_file.size() - WavHeaderSize;
+        m_file.seek(0);
+        writeWavHeader(dataSize);
+    }
+    m_file.close();
+}
+
+void FilePlayback::writeWavHeader(qint64 dataSize)
+{
+    const QAudioFormat &format = this->format();
+    char header[WavHeaderSize];
+
+    std::memcpy(header, "RIFF", 4);
+    writeLittleEndian(header + 4, quint32(dataSize + WavHeaderSize - 8), 4);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    writeLittleEndian(header + 16, 16, 4);
+    writeLittleEndian(header + 20, 1, 2);       // integer PCM
+    writeLittleEndian(header + 22, quint32(format.channelCount()), 2);
+    writeLittleEndian(header + 24, quint32(format.sampleRate()), 4);
+    writeLittleEndian(header + 28, quint32(format.sampleRate() * format.bytesPerFrame()), 4);
+    writeLittleEndian(header + 32, quint32(format.bytesPerFrame()), 2);
+    writeLittleEndian(header + 34, quint32(format.bytesPerSample() * 8), 2);
+    std::memcpy(header + 36, "data", 4);
+    writeLittleEndian(header + 40, quint32(dataSize), 4);
+
+    m_file.write(header, WavHeaderSize);
+}
@@ -0,0 +1,81 @@
+#ifndef FILEPLAYBACK_H
+#define FILEPLAYBACK_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include "Audio/AudioEndpoint.h"
+
+/**
+ * Playout without a sound card: reads the playout device every PeriodMs
+ * on its own real-time clock, as a device would, and hands each period
+ * to consume(). Subclasses must call stop() in their destructor.
+ */
+class ClockedPlayback : public PlaybackEndpoint
+{
+public:
+    static constexpr int PeriodMs = 10;
+
+    explicit ClockedPlayback(const QAudioFormat &format);
+    ~ClockedPlayback();
+
+    bool start(PlayoutDevice *device) override;
+    void stop() override;
+
+    quint64 bytesPlayed() const { return m_bytesPlayed.load(std::memory_order_relaxed); }
+    // Periods the clock was already past when the read returned.
+    quint64 lateReads() const { return m_lateReads.load(std::memory_order_relaxed); }
+
+protected:
+    virtual bool open() { return true; }
+    // Called on the playback thread.
+    virtual void consume(const char *data, qint64 size) = 0;
+    virtual void close() {}
+
+    const QAudioFormat &format() const { return m_format; }
+
+private:
+    void playLoop(PlayoutDevice *device);
+
+    QAudioFormat            m_format;
+    QThread                *m_thread = nullptr;
+    std::atomic<bool>       m_running{false};
+    std::atomic<quint64>    m_bytesPlayed{0};
+    std::atomic<quint64>    m_lateReads{0};
+};
+
+// Writes the received audio to a .wav file, or raw PCM for any other name.
+class FilePlayback : public ClockedPlayback
+{
+public:
+    FilePlayback(const QString &path, const QAudioFormat &format);
+    ~FilePlayback();
+
+protected:
+    bool open() override;
+    void consume(const char *data, qint64 size) override;
+    void close() override;
+
+private:
+    void writeWavHeader(qint64 dataSize);
+
+    QString m_path;
+    QFile   m_file;
+    bool    m_isWav;
+};
+
+// Decodes and throws the audio away, for benchmarks of the receive path.
+class NullPlayback : public ClockedPlayback
+{
+public:
+    explicit NullPlayback(const QAudioFormat &format) : ClockedPlayback(format) {}
+    ~NullPlayback() { stop(); }
+
+protected:
+    void consume(const char *data, qint64 size) override {}
+};
+
+#endif
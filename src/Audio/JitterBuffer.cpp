@@ -0,0 +1,194 @@
+#include "JitterBuffer.h"
+#include <cstring>
+
+JitterBuffer::JitterBuffer(int clockRate)
+    : m_clockRate(clockRate)
+{}
+
+void JitterBuffer::reset()
+{
+    for (Packet &packet : m_slots)
+        packet.occupied = false;
+
+    m_count = 0;
+    m_hasNext = false;
+    m_hasPlayed = false;
+    m_playing = false;
+    m_hasArrival = false;
+    m_jitterMs = 0.0;
+}
+
+bool JitterBuffer::insert(quint16 sequenceNumber, quint32 timestamp, int samples,
+                          const char *payload, int size, qint64 arrivalUs)
+{
+    if (size <= 0 || size > MaxPayloadSize || samples <= 0) {
+        ++m_discardedPackets;
+        return false;
+    }
+
+    if (!m_hasNext) {
+        m_nextSequence = sequenceNumber;
+        m_hasNext = true;
+    }
+
+    const qint16 distance = qint16(sequenceNumber - m_nextSequence);
+    if (distance < 0) {
+        // Before anything was played the stream may still start earlier
+        // than the first packet we saw; after that, it is simply too late.
+        if (m_hasPlayed || m_playing || quint16(m_highestSequence - sequenceNumber) >= Capacity) {
+            ++m_latePackets;
+            return false;
+        }
+        m_nextSequence = sequenceNumber;
+    } else if (distance >= Capacity) {
+        // Too far ahead to fit: the sender restarted or we stalled for a
+        // long time. Drop what we have and resynchronise on this packet.
+        m_discardedPackets += m_count;
+        for (Packet &packet : m_slots)
+            packet.occupied = false;
+        m_count = 0;
+        m_playing = false;
+        m_hasPlayed = false;
+        m_nextSequence = sequenceNumber;
+    }
+
+    Packet &entry = slot(sequenceNumber);
+    if (entry.occupied) {
+        ++m_duplicatePackets;
+        return false;
+    }
+
+    entry.sequenceNumber = sequenceNumber;
+    entry.timestamp = timestamp;
+    entry.samples = samples;
+    entry.size = size;
+    entry.occupied = true;
+    std::memcpy(entry.payload, payload, size);
+
+    if (m_count == 0 || qint16(sequenceNumber - m_highestSequence) > 0) {
+        m_highestSequence = sequenceNumber;
+        m_highestEnd = timestamp + quint32(samples);
+    }
+    ++m_count;
+
+    updateJitter(timestamp, arrivalUs);
+    return true;
+}
+
+JitterBuffer::Status JitterBuffer::pop(const Packet **packet)
+{
+    if (m_count == 0) {
+        // Underrun, or silence with DTX: build the delay up again before
+        // the next talkspurt starts playing.
+        m_playing = false;
+        return Status::Buffering;
+    }
+
+    if (!m_playing) {
+        if (bufferedMs() < targetDelayMs())
+            return Status::Buffering;
+
+        const Packet *first = firstBuffered();
+        m_nextSequence = first->sequenceNumber;
+        m_playoutTimestamp = first->timestamp;
+        m_playing = true;
+    }
+
+    // Trim the excess after a jitter spike so latency comes back down.
+    const int frameMs = m_frameSamples * 1000 / m_clockRate;
+    const int excessLimitMs = targetDelayMs() + qMax(2 * frameMs, 20);
+    while (m_count > 1 && peek() && bufferedMs() > excessLimitMs)
+        discardNext();
+
+    Packet &next = slot(m_nextSequence);
+    if (next.occupied && next.sequenceNumber == m_nextSequence) {
+        next.occupied = false;
+        --m_count;
+        ++m_nextSequence;
+        m_playoutTimestamp = next.timestamp + quint32(next.samples);
+        m_frameSamples = next.samples;
+        m_hasPlayed = true;
+        *packet = &next;
+        return Status::Ready;
+    }
+
+    // Give a reordered packet until the buffer is full again before
+    // declaring it lost.
+    if (bufferedMs() < targetDelayMs())
+        return Status::Buffering;
+
+    ++m_missingPackets;
+    ++m_nextSequence;
+    m_playoutTimestamp += quint32(m_frameSamples);
+    m_hasPlayed = true;
+    return Status::Missing;
+}
+
+const JitterBuffer::Packet *JitterBuffer::peek() const
+{
+    const Packet &next = slot(m_nextSequence);
+    if (m_hasNext && next.occupied && next.sequenceNumber == m_nextSequence)
+        return &next;
+    return nullptr;
+}
+
+int JitterBuffer::targetDelayMs() const
+{
+    const double frameMs = m_frameSamples * 1000.0 / m_clockRate;
+    const int target = int(frameMs + 4.0 * m_jitterMs + 0.5);
+    return qBound(MinDelayMs, target, MaxDelayMs);
+}
+
+int JitterBuffer::bufferedMs() const
+{
+    if (m_count == 0)
+        return 0;
+
+    const qint32 samples = qint32(m_highestEnd - playoutTimestamp());
+    return samples > 0 ? int(qint64(samples) * 1000 / m_clockRate) : 0;
+}
+
+const JitterBuffer::Packet *JitterBuffer::firstBuffered() const
+{
+    for (int i = 0; i < Capacity; ++i) {
+        const quint16 sequenceNumber = quint16(m_nextSequence + i);
+        const Packet &entry = slot(sequenceNumber);
+        if (entry.occupied && entry.sequenceNumber == sequenceNumber)
+            return &entry;
+    }
+    return nullptr;
+}
+
+quint32 JitterBuffer::playoutTimestamp() const
+{
+    if (!m_playing) {
+        if (const Packet *first = firstBuffered())
+            return first->timestamp;
+    }
+    return m_playoutTimestamp;
+}
+
+void JitterBuffer::updateJitter(quint32 timestamp, qint64 arrivalUs)
+{
+    // RFC 3550 A.8, in milliseconds.
+    if (m_hasArrival) {
+        const double arrivalDeltaMs = (arrivalUs - m_lastArrivalUs) / 1000.0;
+        const double mediaDeltaMs = qint32(timestamp - m_lastTimestamp) * 1000.0 / m_clockRate;
+        const double deviation = qAbs(arrivalDeltaMs - mediaDeltaMs);
+        m_jitterMs += (deviation - m_jitterMs) / 16.0;
+    }
+
+    m_hasArrival = true;
+    m_lastTimestamp = timestamp;
+    m_lastArrivalUs = arrivalUs;
+}
+
+void JitterBuffer::discardNext()
+{
+    Packet &next = slot(m_nextSequence);
+    next.occupied = false;
+    --m_count;
+    ++m_nextSequence;
+    m_playoutTimestamp = next.timestamp + quint32(next.samples);
+    ++m_discardedPackets;
+}
@@ -0,0 +1,96 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <QtGlobal>
+#include <array>
+
+/**
+ * Receive-side jitter buffer for one RTP audio stream.
+ *
+ * Packets are stored in preallocated slots indexed by sequence number, so
+ * reordering and duplicates cost nothing and late packets are rejected on
+ * insert. Playout is driven by the caller's clock through pop(): the buffer
+ * holds back until it covers the target delay, which follows the RFC 3550
+ * interarrival jitter estimate, and trims itself when the network calms
+ * down again. Not thread safe.
+ */
+class JitterBuffer
+{
+public:
+    static constexpr int Capacity = 64;
+    static constexpr int MaxPayloadSize = 1500;
+    static constexpr int MinDelayMs = 10;
+    static constexpr int MaxDelayMs = 300;
+
+    struct Packet {
+        quint16 sequenceNumber = 0;
+        quint32 timestamp = 0;
+        int samples = 0;
+        int size = 0;
+        bool occupied = false;
+        unsigned char payload[MaxPayloadSize];
+    };
+
+    enum class Status {
+        Ready,      // *packet is the next frame to play
+        Missing,    // the next frame is lost; conceal it
+        Buffering   // nothing to play yet
+    };
+
+    explicit JitterBuffer(int clockRate = 48000);
+
+    void reset();
+
+    // samples: duration of the payload in RTP clock ticks.
+    bool insert(quint16 sequenceNumber, quint32 timestamp, int samples,
+                const char *payload, int size, qint64 arrivalUs);
+
+    // On Ready, *packet stays valid until the next insert().
+    Status pop(const Packet **packet);
+
+    // The next packet in sequence, if it has already arrived.
+    const Packet *peek() const;
+
+    // Duration of the most recently played frame, in RTP clock ticks.
+    int frameSamples() const { return m_frameSamples; }
+    double jitterMs() const { return m_jitterMs; }
+    int targetDelayMs() const;
+    int bufferedMs() const;
+
+    quint64 latePackets() const { return m_latePackets; }
+    quint64 duplicatePackets() const { return m_duplicatePackets; }
+    quint64 missingPackets() const { return m_missingPackets; }
+    quint64 discardedPackets() const { return m_discardedPackets; }
+
+private:
+    Packet &slot(quint16 sequenceNumber) { return m_slots[sequenceNumber % Capacity]; }
+    const Packet &slot(quint16 sequenceNumber) const { return m_slots[sequenceNumber % Capacity]; }
+    const Packet *firstBuffered() const;
+    quint32 playoutTimestamp() const;
+    void updateJitter(quint32 timestamp, qint64 arrivalUs);
+    void discardNext();
+
+    std::array<Packet, Capacity>    m_slots;
+    int                             m_clockRate;
+    int                             m_count = 0;
+    bool                            m_hasNext = false;
+    bool                            m_hasPlayed = false;
+    bool                            m_playing = false;
+    quint16                         m_nextSequence = 0;
+    quint16                         m_highestSequence = 0;
+    quint32                         m_highestEnd = 0;
+    quint32                         m_playoutTimestamp = 0;
+    int                             m_frameSamples = 960;
+
+    bool                            m_hasArrival = false;
+    quint32                         m_lastTimestamp = 0;
+    qint64                          m_lastArrivalUs = 0;
+    double                          m_jitterMs = 0.0;
+
+    quint64                         m_latePackets = 0;
+    quint64                         m_duplicatePackets = 0;
+    quint64                         m_missingPackets = 0;
+    quint64                         m_discardedPackets = 0;
+};
+
+#endif
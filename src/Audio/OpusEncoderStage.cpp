@@ -0,0 +1,144 @@
+#include "OpusEncoderStage.h"
+#include <QDebug>
+#include <algorithm>
+
+OpusEncoderStage::OpusEncoderStage(int sampleRate, int channels, int headroomSize, int maxPacketSize)
+    : PipelineStage("opus-encoder"),
+    m_input(this, [this](const FrameRef<qint16> &pcm) { encode(pcm); }),
+    m_packetPool(PacketPoolSize, maxPacketSize, headroomSize)
+{
+    int error;
+    m_encoder = opus_encoder_create(sampleRate, channels, m_activeProfile.application, &error);
+    if (error != OPUS_OK) {
+        qDebug() << "Failed to create Opus encoder:" << opus_strerror(error);
+        m_encoder = nullptr;
+    } else {
+        configureEncoder(m_activeProfile);
+        setPacketLossHint(0);
+    }
+    m_requestedProfile = m_activeProfile;
+}
+
+OpusEncoderStage::~OpusEncoderStage()
+{
+    if (m_encoder) {
+        opus_encoder_destroy(m_encoder);
+    }
+}
+
+bool OpusEncoderStage::setProfile(const EncoderProfile &profile)
+{
+    if (!profile.isValid()) {
+        qDebug() << "Rejected invalid Opus encoder profile";
+        return false;
+    }
+
+    QMutexLocker locker(&m_profileMutex);
+    m_requestedProfile = profile;
+    m_profileChanged.store(true, std::memory_order_release);
+    return true;
+}
+
+EncoderProfile OpusEncoderStage::profile() const
+{
+    QMutexLocker locker(&m_profileMutex);
+    return m_requestedProfile;
+}
+
+void OpusEncoderStage::setNetworkTarget(int bitrate, int packetLossPercent)
+{
+    m_targetBitrate.store(bitrate, std::memory_order_relaxed);
+    m_targetPacketLoss.store(packetLossPercent, std::memory_order_relaxed);
+    m_networkTargetChanged.store(true, std::memory_order_release);
+}
+
+void OpusEncoderStage::encode(const FrameRef<qint16> &pcm)
+{
+    if (!m_encoder) {
+        return;
+    }
+    if (m_profileChanged.load(std::memory_order_acquire)) {
+        applyPendingProfile();
+    }
+    if (m_networkTargetChanged.load(std::memory_order_acquire)) {
+        applyNetworkTarget();
+    }
+
+    FrameRef<unsigned char> packet = m_packetPool.acquire();
+    if (!packet) {
+        return;
+    }
+
+    const int encodedBytes = opus_encode(m_encoder, pcm->data(), pcm->frameSamples, packet->data(), packet->capacity());
+    if (encodedBytes < 0) {
+        qDebug() << "Opus encoding error:" << opus_strerror(encodedBytes);
+        return;
+    }
+
+    // With DTX, packets of one or two bytes mean "nothing to send": the
+    // receiver keeps generating comfort noise until real audio returns.
+    if (encodedBytes <= 2 && m_activeProfile.dtx) {
+        return;
+    }
+
+    packet->setSize(encodedBytes);
+    packet->samplePosition = pcm->samplePosition;
+    packet->frameSamples = pcm->frameSamples;
+    packet->captureUs = pcm->captureUs;
+    m_output.push(packet);
+}
+
+void OpusEncoderStage::applyPendingProfile()
+{
+    EncoderProfile profile;
+    {
+        QMutexLocker locker(&m_profileMutex);
+        profile = m_requestedProfile;
+        m_profileChanged.store(false, std::memory_order_relaxed);
+    }
+
+    // The application can only be changed before the first frame, so
+    // rewind the encoder to that point; bitrate and the other CTLs survive
+    // OPUS_RESET_STATE.
+    if (profile.application != m_activeProfile.application) {
+        opus_encoder_ctl(m_encoder, OPUS_RESET_STATE);
+        int error = opus_encoder_ctl(m_encoder, OPUS_SET_APPLICATION(profile.application));
+        if (error != OPUS_OK) {
+            qDebug() << "Failed to switch Opus application:" << opus_strerror(error);
+            profile.application = m_activeProfile.application;
+        }
+    }
+
+    configureEncoder(profile);
+    m_activeProfile = profile;
+    setPacketLossHint(m_targetPacketLoss.load(std::memory_order_relaxed));
+}
+
+void OpusEncoderStage::applyNetworkTarget()
+{
+    m_networkTargetChanged.store(false, std::memory_order_relaxed);
+
+    const int bitrate = m_targetBitrate.load(std::memory_order_relaxed);
+    if (bitrate != OPUS_AUTO) {
+        opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(bitrate));
+    }
+    setPacketLossHint(m_targetPacketLoss.load(std::memory_order_relaxed));
+}
+
+void OpusEncoderStage::setPacketLossHint(int packetLossPercent)
+{
+    if (m_activeProfile.inbandFec) {
+        packetLossPercent = std::max(packetLossPercent, int(MinFecPacketLoss));
+    }
+    opus_encoder_ctl(m_encoder, OPUS_SET_PACKET_LOSS_PERC(packetLossPercent));
+}
+
+void OpusEncoderStage::configureEncoder(const EncoderProfile &profile)
+{
+    opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(profile.complexity));
+    opus_encoder_ctl(m_encoder, OPUS_SET_MAX_BANDWIDTH(profile.maxBandwidth));
+    opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(profile.signal));
+    opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(profile.bitrate));
+    opus_encoder_ctl(m_encoder, OPUS_SET_INBAND_FEC(profile.inbandFec ? 1 : 0));
+    opus_encoder_ctl(m_encoder, OPUS_SET_DTX(profile.dtx ? 1 : 0));
+}
@@ -0,0 +1,64 @@
+#ifndef OPUSENCODERSTAGE_H
+#define OPUSENCODERSTAGE_H
+
+#include <QMutex>
+#include <atomic>
+#include "opus.h"
+#include "Audio/EncoderProfile.h"
+#include "Pipeline/PipelinePort.h"
+
+/**
+ * PCM frames in, Opus packets out. Each packet is encoded straight into a
+ * pooled frame whose headroom the sender can fill with its own header, so
+ * nothing is copied on the way to the network. Profile and network target
+ * changes are applied before the next frame; the encoder itself is never
+ * recreated. Frames arrive on the capture thread.
+ */
+class OpusEncoderStage : public PipelineStage
+{
+public:
+    static constexpr int MaxPacketSize = 4000;
+    // Opus only spends bits on in-band FEC when it expects some loss.
+    static constexpr int MinFecPacketLoss = 5;
+    // Packets the stages behind the encoder can hold on to at once.
+    static constexpr int PacketPoolSize = 16;
+
+    // headroomSize bytes are kept free in front of every packet.
+    OpusEncoderStage(int sampleRate, int channels, int headroomSize = 0, int maxPacketSize = MaxPacketSize);
+    ~OpusEncoderStage();
+
+    InputPort<qint16> &input() { return m_input; }
+    OutputPort<unsigned char> &output() { return m_output; }
+
+    bool setProfile(const EncoderProfile &profile);
+    EncoderProfile profile() const;
+
+    // Live network adaptation (OPUS_SET_BITRATE / OPUS_SET_PACKET_LOSS_PERC).
+    void setNetworkTarget(int bitrate, int packetLossPercent);
+
+    // Frames not encoded because every packet was still in use downstream.
+    quint64 droppedFrames() const { return m_packetPool.exhausted(); }
+
+private:
+    void encode(const FrameRef<qint16> &pcm);
+    void applyPendingProfile();
+    void applyNetworkTarget();
+    void setPacketLossHint(int packetLossPercent);
+    void configureEncoder(const EncoderProfile &profile);
+
+    InputPort<qint16>           m_input;
+    OutputPort<unsigned char>   m_output;
+    FramePool<unsigned char>    m_packetPool;
+    OpusEncoder                *m_encoder = nullptr;
+
+    mutable QMutex              m_profileMutex;
+    EncoderProfile              m_requestedProfile;
+    std::atomic<bool>           m_profileChanged{false};
+    EncoderProfile              m_activeProfile;
+
+    std::atomic<int>            m_targetBitrate{OPUS_AUTO};
+    std::atomic<int>            m_targetPacketLoss{0};
+    std::atomic<bool>           m_networkTargetChanged{false};
+};
+
+#endif
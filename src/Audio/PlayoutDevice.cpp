@@ -0,0 +1,129 @@
+#include "PlayoutDevice.h"
+#include <algorithm>
+#include <cstring>
+
+PlayoutDevice::PlayoutDevice(int sampleRate, int channels, QObject *parent)
+    : QIODevice(parent), unplayedStreamPackets(0) {
+
+    for (Slot &slot : slots) {
+        slot.stream = std::make_unique<PlayoutStream>(sampleRate, channels);
+    }
+}
+
+void PlayoutDevice::addPacket(quint32 ssrc, const char *payload, int size, quint16 sequenceNumber, quint32 timestamp, qint64 arrivalUs) {
+    const quint64 key = quint64(ssrc) | InUse;
+
+    Slot *slot = findSlot(key);
+    if (!slot) {
+        slot = claimSlot(key, arrivalUs);
+    }
+    if (!slot) {
+        unplayedStreamPackets.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot->lastArrivalUs.store(arrivalUs, std::memory_order_relaxed);
+    slot->stream->addPacket(payload, size, sequenceNumber, timestamp, arrivalUs);
+}
+
+PlayoutDevice::Slot *PlayoutDevice::findSlot(quint64 key) {
+    for (Slot &slot : slots) {
+        if (slot.key.load(std::memory_order_acquire) == key) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+PlayoutDevice::Slot *PlayoutDevice::claimSlot(quint64 key, qint64 arrivalUs) {
+    for (Slot &slot : slots) {
+        quint64 expected = 0;
+        if (slot.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+            return &slot;
+        }
+    }
+
+    // All taken: reuse the slot of a peer that has gone quiet. Its stream
+    // starts over, which may cost the new stream its first packet.
+    for (Slot &slot : slots) {
+        quint64 expected = slot.key.load(std::memory_order_acquire);
+        if (arrivalUs - slot.lastArrivalUs.load(std::memory_order_relaxed) < StaleStreamUs) {
+            continue;
+        }
+        if (slot.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+            slot.stream->reset();
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void PlayoutDevice::reset() {
+    for (Slot &slot : slots) {
+        slot.stream->reset();
+        slot.key.store(0, std::memory_order_release);
+    }
+}
+
+PlayoutStats PlayoutDevice::stats() const {
+    PlayoutStats stats;
+    for (const Slot &slot : slots) {
+        if (slot.key.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+
+        const PlayoutStats stream = slot.stream->stats();
+        stats.jitterMs = std::max(stats.jitterMs, stream.jitterMs);
+        stats.targetDelayMs = std::max(stats.targetDelayMs, stream.targetDelayMs);
+        stats.bufferedMs = std::max(stats.bufferedMs, stream.bufferedMs);
+        stats.latePackets += stream.latePackets;
+        stats.duplicatePackets += stream.duplicatePackets;
+        stats.missingPackets += stream.missingPackets;
+        stats.discardedPackets += stream.discardedPackets;
+        stats.concealedSamples += stream.concealedSamples;
+        stats.fecDecodedFrames += stream.fecDecodedFrames;
+        stats.receiveQueueDrops += stream.receiveQueueDrops;
+    }
+    stats.unplayedStreamPackets = unplayedStreamPackets.load(std::memory_order_relaxed);
+    return stats;
+}
+
+qint64 PlayoutDevice::bytesAvailable() const {
+    // Playout never ends: there is always a frame, real or concealed.
+    return qint64(PlayoutStream::MaxFrameSamples) * sizeof(opus_int16) + QIODevice::bytesAvailable();
+}
+
+qint64 PlayoutDevice::readData(char *data, qint64 maxlen) {
+    // Only hand out whole samples.
+    maxlen -= maxlen % qint64(sizeof(opus_int16));
+
+    for (Slot &slot : slots) {
+        slot.stream->applyReset();
+    }
+
+    qint64 written = 0;
+    while (written < maxlen) {
+        const int samples = int(std::min<qint64>((maxlen - written) / qint64(sizeof(opus_int16)),
+                                                 PlayoutStream::MaxFrameSamples));
+        std::fill_n(mixData, samples, 0);
+
+        for (Slot &slot : slots) {
+            if (slot.key.load(std::memory_order_acquire) == 0) {
+                continue;
+            }
+
+            slot.stream->read(streamData, samples);
+            for (int i = 0; i < samples; ++i) {
+                mixData[i] += streamData[i];
+            }
+        }
+
+        for (int i = 0; i < samples; ++i) {
+            streamData[i] = opus_int16(std::clamp(mixData[i], -32768, 32767));
+        }
+        std::memcpy(data + written, streamData, qint64(samples) * sizeof(opus_int16));
+        written += qint64(samples) * sizeof(opus_int16);
+    }
+
+    return written;
+}
@@ -0,0 +1,72 @@
+#ifndef PLAYOUTDEVICE_H
+#define PLAYOUTDEVICE_H
+
+#include <QIODevice>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "Audio/PlayoutStream.h"
+
+/**
+ * Pull-mode source for QAudioSink. The sink calls readData() whenever the
+ * device needs audio; each call reads the same stretch from every received
+ * stream and mixes them, so output latency tracks the device buffer only.
+ *
+ * Each stream, keyed by its SSRC, gets its own receive queue, jitter
+ * buffer and decoder, so peers never interleave in one sequence space.
+ * addPacket() may be called from several network threads at once as long
+ * as each SSRC comes from one thread at a time; a new SSRC claims a slot
+ * with a compare-and-swap, and nothing on the producer side locks or
+ * allocates.
+ */
+class PlayoutDevice : public QIODevice {
+    Q_OBJECT
+
+public:
+    // Streams mixed at once; every slot is allocated up front.
+    static constexpr int MaxStreams = 8;
+    // A stream silent for this long gives its slot up to a new one.
+    static constexpr qint64 StaleStreamUs = 2000000;
+
+    explicit PlayoutDevice(int sampleRate, int channels, QObject *parent = nullptr);
+
+    // Producer side. Never blocks; counts a drop when there is no slot
+    // for the stream or its queue is full.
+    void addPacket(quint32 ssrc, const char *payload, int size, quint16 sequenceNumber, quint32 timestamp, qint64 arrivalUs);
+    // The worst jitter and delay and the total counters of the streams
+    // being played.
+    PlayoutStats stats() const;
+    // Starts over for the next call: frees every slot, and each stream
+    // drops its queued packets and resets its jitter buffer and decoder
+    // on the reading side. Safe from any thread.
+    void reset();
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override { return 0; }
+
+private:
+    // key is the SSRC with InUse set, or 0 while the slot is free.
+    struct Slot {
+        std::atomic<quint64> key{0};
+        std::atomic<qint64> lastArrivalUs{0};
+        std::unique_ptr<PlayoutStream> stream;
+    };
+
+    static constexpr quint64 InUse = quint64(1) << 32;
+
+    Slot *findSlot(quint64 key);
+    Slot *claimSlot(quint64 key, qint64 arrivalUs);
+
+    std::array<Slot, MaxStreams> slots;
+    std::atomic<quint64> unplayedStreamPackets;
+
+    // Mixing scratch, only touched by the reading side.
+    opus_int16 streamData[PlayoutStream::MaxFrameSamples];
+    int mixData[PlayoutStream::MaxFrameSamples];
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "PlayoutStream.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+PlayoutStream::PlayoutStream(int sampleRate, int channels)
+    : receiveQueueDrops(0), resetRequested(false), jitter(sampleRate), opusDecoder(nullptr), sampleRate(sampleRate),
+    channels(channels), hasPlayed(false), concealedMs(0), concealedSampleCount(0),
+    fecFrameCount(0), pcmSize(0), pcmOffset(0) {
+
+    int error;
+    opusDecoder = opus_decoder_create(sampleRate, channels, &error);
+    if (error != OPUS_OK) {
+        qDebug() << "Failed to create Opus decoder:" << opus_strerror(error);
+    }
+}
+
+PlayoutStream::~PlayoutStream() {
+    if (opusDecoder) {
+        opus_decoder_destroy(opusDecoder);
+    }
+}
+
+void PlayoutStream::addPacket(const char *payload, int size, quint16 sequenceNumber, quint32 timestamp, qint64 arrivalUs) {
+    const int samples = opus_packet_get_nb_samples(reinterpret_cast<const unsigned char *>(payload), size, sampleRate);
+    if (samples <= 0) {
+        qDebug() << "Dropping malformed Opus packet" << sequenceNumber;
+        return;
+    }
+
+    if (size > JitterBuffer::MaxPayloadSize) {
+        qDebug() << "Dropping oversized Opus packet" << sequenceNumber << "of" << size << "bytes";
+        return;
+    }
+
+    ReceivedPacket *slot = receiveQueue.beginPush();
+    if (!slot) {
+        receiveQueueDrops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot->sequenceNumber = sequenceNumber;
+    slot->timestamp = timestamp;
+    slot->samples = samples;
+    slot->arrivalUs = arrivalUs;
+    slot->size = size;
+    std::memcpy(slot->payload, payload, size);
+    receiveQueue.endPush();
+}
+
+PlayoutStats PlayoutStream::stats() const {
+    QMutexLocker locker(&statsMutex);
+    PlayoutStats stats = statsSnapshot;
+    stats.receiveQueueDrops = receiveQueueDrops.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void PlayoutStream::drainReceiveQueue() {
+    while (const ReceivedPacket *packet = receiveQueue.front()) {
+        jitter.insert(packet->sequenceNumber, packet->timestamp, packet->samples,
+                      reinterpret_cast<const char *>(packet->payload), packet->size, packet->arrivalUs);
+        receiveQueue.pop();
+    }
+}
+
+void PlayoutStream::resetPlayout() {
+    while (receiveQueue.front()) {
+        receiveQueue.pop();
+    }
+    jitter.reset();
+    if (opusDecoder) {
+        opus_decoder_ctl(opusDecoder, OPUS_RESET_STATE);
+    }
+    hasPlayed = false;
+    concealedMs = 0;
+    pcmSize = 0;
+    pcmOffset = 0;
+}
+
+void PlayoutStream::publishStats() {
+    if (!statsMutex.tryLock()) {
+        return;
+    }
+
+    statsSnapshot.jitterMs = jitter.jitterMs();
+    statsSnapshot.targetDelayMs = jitter.targetDelayMs();
+    statsSnapshot.bufferedMs = jitter.bufferedMs();
+    statsSnapshot.latePackets = jitter.latePackets();
+    statsSnapshot.duplicatePackets = jitter.duplicatePackets();
+    statsSnapshot.missingPackets = jitter.missingPackets();
+    statsSnapshot.discardedPackets = jitter.discardedPackets();
+    statsSnapshot.concealedSamples = concealedSampleCount;
+    statsSnapshot.fecDecodedFrames = fecFrameCount;
+    statsMutex.unlock();
+}
+
+void PlayoutStream::applyReset() {
+    if (resetRequested.exchange(false, std::memory_order_acquire)) {
+        resetPlayout();
+    }
+}
+
+void PlayoutStream::read(opus_int16 *data, int samples) {
+    int written = 0;
+    while (written < samples) {
+        if (pcmOffset == pcmSize) {
+            drainReceiveQueue();
+            decodeNextFrame();
+        }
+
+        const int count = std::min(samples - written, pcmSize - pcmOffset);
+        std::copy_n(pcmData + pcmOffset, count, data + written);
+        written += count;
+        pcmOffset += count;
+    }
+
+    publishStats();
+}
+
+void PlayoutStream::decodeNextFrame() {
+    pcmSize = 0;
+    pcmOffset = 0;
+
+    const JitterBuffer::Packet *packet = nullptr;
+    switch (jitter.pop(&packet)) {
+    case JitterBuffer::Status::Ready: {
+        const int decodedSamples = opus_decode(opusDecoder, packet->payload, packet->size, pcmData,
+                                               MaxFrameSamples / channels, 0);
+        if (decodedSamples < 0) {
+            qDebug() << "Opus decoding error:" << opus_strerror(decodedSamples);
+            conceal(nullptr, packet->samples);
+            return;
+        }
+        hasPlayed = true;
+        concealedMs = 0;
+        pcmSize = decodedSamples * channels;
+        return;
+    }
+    case JitterBuffer::Status::Missing:
+        conceal(jitter.peek(), jitter.frameSamples());
+        return;
+    case JitterBuffer::Status::Buffering:
+        // Mid-stream the sink must never run dry; before the first frame
+        // just hand out short silence until the jitter buffer is primed.
+        if (hasPlayed) {
+            conceal(nullptr, jitter.frameSamples());
+        } else {
+            writeSilence(sampleRate * IdleChunkMs / 1000);
+        }
+        return;
+    }
+}
+
+void PlayoutStream::conceal(const JitterBuffer::Packet *next, int samples) {
+    // PLC and FEC must produce exactly the duration of the missing audio.
+    samples = qBound(sampleRate / 400, samples, MaxFrameSamples / channels);
+
+    if (concealedMs >= MaxConcealMs) {
+        writeSilence(samples);
+        concealedSampleCount += samples;
+        return;
+    }
+
+    // Prefer the in-band FEC copy in the following packet; without one,
+    // or if it carries no FEC data, Opus falls back to PLC.
+    int decodedSamples;
+    if (next) {
+        decodedSamples = opus_decode(opusDecoder, next->payload, next->size, pcmData, samples, 1);
+        if (decodedSamples > 0) {
+            ++fecFrameCount;
+        }
+    } else {
+        decodedSamples = opus_decode(opusDecoder, nullptr, 0, pcmData, samples, 0);
+    }
+
+    if (decodedSamples < 0) {
+        qDebug() << "Opus concealment error:" << opus_strerror(decodedSamples);
+        writeSilence(samples);
+    } else {
+        pcmSize = decodedSamples * channels;
+    }
+
+    concealedMs += samples * 1000 / sampleRate;
+    concealedSampleCount += samples;
+}
+
+void PlayoutStream::writeSilence(int samples) {
+    pcmSize = std::min(samples * channels, MaxFrameSamples);
+    pcmOffset = 0;
+    std::fill_n(pcmData, pcmSize, opus_int16(0));
+}
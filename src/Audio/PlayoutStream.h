@@ -0,0 +1,94 @@
+#ifndef PLAYOUTSTREAM_H
+#define PLAYOUTSTREAM_H
+
+#include <QMutex>
+#include <atomic>
+#include <opus.h>
+#include "Audio/JitterBuffer.h"
+#include "Audio/ReceiveQueue.h"
+
+struct PlayoutStats {
+    double jitterMs = 0.0;
+    int targetDelayMs = 0;
+    int bufferedMs = 0;
+    quint64 latePackets = 0;
+    quint64 duplicatePackets = 0;
+    quint64 missingPackets = 0;
+    quint64 discardedPackets = 0;
+    quint64 concealedSamples = 0;
+    quint64 fecDecodedFrames = 0;
+    quint64 receiveQueueDrops = 0;
+    // Packets from a stream that found no free slot in the playout device.
+    quint64 unplayedStreamPackets = 0;
+};
+
+/**
+ * One received stream on its way to the speaker: a receive queue, a jitter
+ * buffer and an Opus decoder. read() takes the next frames from the jitter
+ * buffer and decodes them just in time, concealing anything that is
+ * missing.
+ *
+ * addPacket() may be called from one network thread at a time while the
+ * reading side calls read() on another; packets cross over through a
+ * lock-free SPSC queue and the jitter buffer and decoder are only touched
+ * by the reading side.
+ */
+class PlayoutStream {
+public:
+    // Longest Opus packet (120 ms) at 48 kHz.
+    static constexpr int MaxFrameSamples = 5760;
+    // Silence handed out per request before playout has started.
+    static constexpr int IdleChunkMs = 10;
+    // Opus PLC fades to silence on its own; past this, just write zeros.
+    static constexpr int MaxConcealMs = 200;
+
+    PlayoutStream(int sampleRate, int channels);
+    ~PlayoutStream();
+
+    // Producer side. Never blocks; counts a drop when the queue is full.
+    void addPacket(const char *payload, int size, quint16 sequenceNumber, quint32 timestamp, qint64 arrivalUs);
+    // Last snapshot published by the reading side.
+    PlayoutStats stats() const;
+    // Starts over for a new stream: the reading side drops queued packets,
+    // empties the jitter buffer and resets the decoder in its next
+    // applyReset(). Safe from any thread.
+    void reset() { resetRequested.store(true, std::memory_order_release); }
+
+    // Reading side.
+    void applyReset();
+    // Writes exactly samples interleaved samples, real or concealed.
+    void read(opus_int16 *data, int samples);
+
+private:
+    void drainReceiveQueue();
+    void resetPlayout();
+    void publishStats();
+    void decodeNextFrame();
+    void conceal(const JitterBuffer::Packet *next, int samples);
+    void writeSilence(int samples);
+
+    ReceiveQueue receiveQueue;
+    std::atomic<quint64> receiveQueueDrops;
+    std::atomic<bool> resetRequested;
+
+    // Only guards the published snapshot; the reading side uses tryLock
+    // and never waits for it.
+    mutable QMutex statsMutex;
+    PlayoutStats statsSnapshot;
+
+    JitterBuffer jitter;
+    OpusDecoder *opusDecoder;
+    int sampleRate;
+    int channels;
+    bool hasPlayed;
+    int concealedMs;
+    quint64 concealedSampleCount;
+    quint64 fecFrameCount;
+
+    // The frame being played out, in samples.
+    opus_int16 pcmData[MaxFrameSamples];
+    int pcmSize;
+    int pcmOffset;
+};
+
+#endif
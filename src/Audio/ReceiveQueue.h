@@ -0,0 +1,23 @@
+#ifndef RECEIVEQUEUE_H
+#define RECEIVEQUEUE_H
+
+#include <QtGlobal>
+#include "Audio/JitterBuffer.h"
+#include "Utils/SpscQueue.h"
+
+// One received RTP audio payload on its way from the network thread to
+// the playout thread.
+struct ReceivedPacket {
+    quint16 sequenceNumber;
+    quint32 timestamp;
+    int samples;
+    qint64 arrivalUs;
+    int size;
+    unsigned char payload[JitterBuffer::MaxPayloadSize];
+};
+
+// 128 slots is 2.5 s of 20 ms audio: the playout side drains it every
+// device period, so it only fills up if playout stops altogether.
+using ReceiveQueue = SpscQueue<ReceivedPacket, 128>;
+
+#endif
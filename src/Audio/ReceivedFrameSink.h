@@ -0,0 +1,24 @@
+#ifndef RECEIVEDFRAMESINK_H
+#define RECEIVEDFRAMESINK_H
+
+#include <QtGlobal>
+
+/**
+ * Consumer of received Opus frames, called straight from the network thread
+ * that depacketized them, so the payload never waits for an event loop or
+ * goes through a QByteArray. payload points into the received RTP packet
+ * and is only valid during the call: copy what you keep, and never block.
+ * With several peers the calls can come from several threads at once, but
+ * the frames of one SSRC come from one thread at a time.
+ */
+class ReceivedFrameSink
+{
+public:
+    virtual ~ReceivedFrameSink() = default;
+
+    // ssrc identifies the sender's stream; sequenceNumber is the 16-bit
+    // wire value and timestamp the RTP timestamp, both within that stream.
+    virtual void frameReceived(quint32 ssrc, const unsigned char *payload, int size, quint16 sequenceNumber, quint32 timestamp) = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+// Counts heap allocations for the benchmarks by replacing the allocator
+// entry points. Defines malloc and friends, so include it in exactly one
+// source file of a benchmark and never in the application.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Allocations so far, from every thread.
+inline std::atomic<unsigned long long> allocationCount{0};
+
+// QByteArray and libdatachannel allocate through malloc rather than
+// operator new, so on glibc count at the malloc level; elsewhere only
+// operator new is visible.
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t count, std::size_t size);
+extern "C" void *__libc_realloc(void *pointer, std::size_t size);
+
+extern "C" void *malloc(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(std::size_t count, std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+// Where allocations are counted, for the report.
+inline const char *allocationsCountedAt = "malloc";
+#else
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+inline const char *allocationsCountedAt = "operator new only (QByteArray and libdatachannel's C code not counted)";
+#endif
+
+#endif
@@ -0,0 +1,451 @@
+// End-to-end benchmark of a whole call inside one process.
+//
+// Two call engines, bench-a (offerer) and bench-b, connect over the
+// loopback interface with host candidates only. The offer, answer and
+// trickled candidates are handed across in memory instead of through the
+// signaling server. Each side captures a tone burst every IntervalMs in
+// real time and sends it through the real send pipeline (AudioInput ->
+// OpusEncoderStage -> RtpSenderStage) and libdatachannel (SRTP over ICE).
+// Each side plays the other's audio through AudioOutput, with its jitter
+// buffer and just-in-time decoder. The playback endpoint is clocked like
+// a sound card and looks for the burst onsets.
+//
+// After WarmupSeconds the call is measured for the given time. Reported:
+// - mouth-to-ear latency: from the capture time of a burst's first sample
+//   to the playout read that hands it out. Capture chunking, encoding, the
+//   network stack, the jitter buffer and decoding are in between; sound
+//   card buffers are not;
+// - packets per second in both directions;
+// - process CPU time as a share of one core, i.e. per call with both ends
+//   in it;
+// - heap allocations per packet, process wide, libdatachannel's threads
+//   included;
+// - the time of each send stage and the playout counters of both ends.
+//
+// Usage: LoopbackBench [seconds, default 20] [profile, default music]
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Audio/AudioInput.h"
+#include "Audio/AudioOutput.h"
+#include "Audio/FilePlayback.h"
+#include "Audio/OpusEncoderStage.h"
+#include "Bench/AllocationCounter.h"
+#include "Network/RtpSenderStage.h"
+#include "Network/webrtc.h"
+#include "Pipeline/Pipeline.h"
+
+// One burst per interval. A latency is only attributed correctly while it
+// stays below this.
+static constexpr int IntervalMs = 500;
+static constexpr int BurstMs = 40;
+static constexpr int ToneHz = 1000;
+static constexpr double Pi = 3.14159265358979323846;
+static constexpr double Amplitude = 16000.0;
+// Well above the decoder's noise in the silence between bursts.
+static constexpr int OnsetThreshold = 6000;
+static constexpr int WarmupSeconds = 2;
+static constexpr int ConnectTimeoutMs = 10000;
+
+static qint64 percentile(std::vector<qint64> &values, double p)
+{
+    if (values.empty())
+        return 0;
+    const std::size_t index = std::min(values.size() - 1, std::size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// offerIsReady and answerIsReady carry {"type": ..., "sdp": ...}.
+static QString sdpOf(const QString &description)
+{
+    return QJsonDocument::fromJson(description.toUtf8()).object()["sdp"].toString();
+}
+
+/**
+ * A microphone that hears silence with a cosine burst every IntervalMs,
+ * written to the input in ChunkMs chunks, each once it is "recorded".
+ * The first sample of every burst is captured at startNs() plus a whole
+ * number of intervals, on the PipelineStage::clockNs() clock.
+ */
+class ToneBurstCapture : public CaptureEndpoint
+{
+public:
+    static constexpr int ChunkMs = 10;
+
+    explicit ToneBurstCapture(const QAudioFormat &format) : m_format(format) {}
+    ~ToneBurstCapture() { stop(); }
+
+    bool start(AudioInput *input) override
+    {
+        if (m_thread)
+            return true;
+
+        m_running.store(true, std::memory_order_release);
+        m_thread = QThread::create([this, input] { captureLoop(input); });
+        m_thread->setObjectName("ToneBurstCapture");
+        m_thread->start();
+        return true;
+    }
+
+    void stop() override
+    {
+        if (!m_thread)
+            return;
+
+        m_running.store(false, std::memory_order_release);
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+
+    // 0 until the first chunk is captured.
+    qint64 startNs() const { return m_startNs.load(std::memory_order_acquire); }
+
+private:
+    void captureLoop(AudioInput *input)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const int rate = m_format.sampleRate();
+        const int channels = m_format.channelCount();
+        const int chunkFrames = rate * ChunkMs / 1000;
+        const qint64 intervalFrames = qint64(rate) * IntervalMs / 1000;
+        const qint64 burstFrames = qint64(rate) * BurstMs / 1000;
+        std::vector<qint16> chunk(std::size_t(chunkFrames) * channels);
+        qint64 position = 0;
+
+        Clock::time_point nextChunk = Clock::now();
+        m_startNs.store(PipelineStage::clockNs(), std::memory_order_release);
+
+        while (m_running.load(std::memory_order_acquire)) {
+            for (int i = 0; i < chunkFrames; ++i, ++position) {
+                const qint64 phase = position % intervalFrames;
+                const qint16 sample = phase < burstFrames
+                    ? qint16(std::lround(Amplitude * std::cos(2.0 * Pi * ToneHz * double(phase) / rate)))
+                    : qint16(0);
+                std::fill_n(chunk.begin() + std::ptrdiff_t(i) * channels, channels, sample);
+            }
+
+            nextChunk += std::chrono::milliseconds(ChunkMs);
+            std::this_thread::sleep_until(nextChunk);
+            input->write(reinterpret_cast<const char *>(chunk.data()), qint64(chunk.size() * sizeof(qint16)));
+        }
+    }
+
+    QAudioFormat            m_format;
+    QThread                *m_thread = nullptr;
+    std::atomic<bool>       m_running{false};
+    std::atomic<qint64>     m_startNs{0};
+};
+
+/**
+ * Playback that times the burst onsets in what playout hands out against
+ * the capture clock of the far end's ToneBurstCapture. A sample counts as
+ * played when the read of its period returns, plus its offset within the
+ * period.
+ */
+class OnsetPlayback : public ClockedPlayback
+{
+public:
+    OnsetPlayback(const QAudioFormat &format, const ToneBurstCapture *source, int maxOnsets)
+        : ClockedPlayback(format),
+        m_source(source),
+        m_latenciesUs(std::size_t(maxOnsets))
+    {
+    }
+    ~OnsetPlayback() { stop(); }
+
+    void setMeasuring(bool measuring) { m_measuring.store(measuring, std::memory_order_release); }
+
+    std::vector<qint64> latenciesUs() const
+    {
+        const std::size_t count = m_count.load(std::memory_order_acquire);
+        return std::vector<qint64>(m_latenciesUs.begin(), m_latenciesUs.begin() + std::ptrdiff_t(count));
+    }
+
+protected:
+    // Does not allocate: the latencies go into storage reserved up front.
+    void consume(const char *data, qint64 size) override
+    {
+        const qint64 readNs = PipelineStage::clockNs();
+        const int rate = format().sampleRate();
+        const int channels = format().channelCount();
+        const qint16 *samples = reinterpret_cast<const qint16 *>(data);
+        const qint64 frames = size / qint64(sizeof(qint16) * channels);
+
+        for (qint64 i = 0; i < frames; ++i) {
+            if (m_holdoffFrames > 0) {
+                --m_holdoffFrames;
+                continue;
+            }
+            if (std::abs(int(samples[i * channels])) < OnsetThreshold)
+                continue;
+
+            // Skip the rest of the burst and the decoder's tail.
+            m_holdoffFrames = qint64(rate) * IntervalMs / 2000;
+
+            const qint64 startNs = m_source->startNs();
+            const std::size_t count = m_count.load(std::memory_order_relaxed);
+            if (!m_measuring.load(std::memory_order_acquire) || startNs == 0 || count == m_latenciesUs.size())
+                continue;
+
+            const qint64 earNs = readNs + i * 1000000000LL / rate;
+            const qint64 latencyNs = (earNs - startNs) % (qint64(IntervalMs) * 1000000);
+            m_latenciesUs[count] = latencyNs / 1000;
+            m_count.store(count + 1, std::memory_order_release);
+        }
+    }
+
+private:
+    const ToneBurstCapture     *m_source;
+    std::atomic<bool>           m_measuring{false};
+    std::vector<qint64>         m_latenciesUs;
+    std::atomic<std::size_t>    m_count{0};
+    qint64                      m_holdoffFrames = 0;
+};
+
+/**
+ * One end of the call, put together the way Client does it, minus the
+ * signaling connection and with the sound card swapped for the tone
+ * capture and onset playback.
+ */
+class CallEnd
+{
+public:
+    CallEnd(const QString &id, bool isOfferer, const EncoderProfile &profile)
+    {
+        webrtc = new WebRTC();
+        audioInput = new AudioInput();
+        encoder = new OpusEncoderStage(audioInput->sampleRate(), audioInput->channelCount(),
+                                       RtpSenderStage::Headroom, RtpSenderStage::MaxPayloadSize);
+        rtpSender = new RtpSenderStage(webrtc);
+        audioOutput = new AudioOutput();
+
+        sendPipeline.addStage(audioInput);
+        sendPipeline.link(audioInput->output(), encoder->input());
+        sendPipeline.link(encoder->output(), rtpSender->input());
+        webrtc->setReceivedFrameSink(audioOutput);
+
+        encoder->setProfile(profile);
+        audioInput->setFrameDuration(profile.frameDurationUs);
+        webrtc->setSdpSettings(profile.bitrate != OPUS_AUTO ? profile.bitrate : webrtc->bitRate(),
+                               profile.inbandFec, profile.dtx);
+        webrtc->setIceSettings(IceSettings::hostOnlyLan());
+
+        std::unique_ptr<ToneBurstCapture> capture = std::make_unique<ToneBurstCapture>(audioInput->format());
+        toneCapture = capture.get();
+        audioInput->setCaptureEndpoint(std::move(capture));
+
+        webrtc->init(id, isOfferer);
+    }
+
+    ~CallEnd()
+    {
+        // Same order as Client: nothing may call into a deleted object.
+        audioInput->stop();
+        delete webrtc;
+        delete audioInput;
+        delete rtpSender;
+        delete encoder;
+        delete audioOutput;
+    }
+
+    // Plays what arrives here and times it against the other end's capture.
+    void listenTo(const CallEnd &other, int maxOnsets)
+    {
+        std::unique_ptr<OnsetPlayback> playback =
+            std::make_unique<OnsetPlayback>(audioOutput->format(), other.toneCapture, maxOnsets);
+        onsetPlayback = playback.get();
+        audioOutput->setPlaybackEndpoint(std::move(playback));
+    }
+
+    WebRTC *webrtc;
+    AudioInput *audioInput;
+    OpusEncoderStage *encoder;
+    RtpSenderStage *rtpSender;
+    AudioOutput *audioOutput;
+    Pipeline sendPipeline;
+    ToneBurstCapture *toneCapture = nullptr;
+    OnsetPlayback *onsetPlayback = nullptr;
+};
+
+struct Snapshot
+{
+    qint64 wallNs = 0;
+    std::clock_t cpu = 0;               // process CPU time, all threads
+    unsigned long long allocations = 0;
+    quint64 packetsSent = 0;
+    quint64 packetsReceived = 0;
+};
+
+static Snapshot takeSnapshot(const CallEnd &offerer, const QString &offererId,
+                             const CallEnd &answerer, const QString &answererId)
+{
+    const PeerRtpStats offererStats = offerer.webrtc->peerStats(answererId);
+    const PeerRtpStats answererStats = answerer.webrtc->peerStats(offererId);
+
+    Snapshot snapshot;
+    snapshot.wallNs = PipelineStage::clockNs();
+    snapshot.cpu = std::clock();
+    snapshot.allocations = allocationCount.load(std::memory_order_relaxed);
+    snapshot.packetsSent = offererStats.packetsSent + answererStats.packetsSent;
+    snapshot.packetsReceived = offererStats.packetsReceived + answererStats.packetsReceived;
+    return snapshot;
+}
+
+static void printEnd(const char *name, const CallEnd &end)
+{
+    std::printf("%s send stages  :", name);
+    for (const StageTiming &timing : end.sendPipeline.timings())
+        std::printf("  %s %.1f/%.1f us", timing.name.toUtf8().constData(), timing.averageUs(), timing.maxNs / 1000.0);
+    std::printf("  (avg/max)\n");
+
+    const PlayoutStats playout = end.audioOutput->stats();
+    std::printf("%s playout      : target %d ms, jitter %.1f ms, late %llu, missing %llu, concealed %llu samples\n",
+                name, playout.targetDelayMs, playout.jitterMs,
+                static_cast<unsigned long long>(playout.latePackets),
+                static_cast<unsigned long long>(playout.missingPackets),
+                static_cast<unsigned long long>(playout.concealedSamples));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int seconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    const QString profileName = argc > 2 ? QString::fromLocal8Bit(argv[2]) : QString("music");
+    EncoderProfile profile;
+    if (!EncoderProfile::fromName(profileName, &profile)) {
+        std::printf("Unknown profile %s: use music, voice, low-latency or low-cpu\n", argv[2]);
+        return 1;
+    }
+
+    const QString offererId = "bench-a";
+    const QString answererId = "bench-b";
+    CallEnd offerer(offererId, true, profile);
+    CallEnd answerer(answererId, false, profile);
+    const int maxOnsets = seconds * 1000 / IntervalMs + 16;
+    offerer.listenTo(answerer, maxOnsets);
+    answerer.listenTo(offerer, maxOnsets);
+
+    // In-memory signaling: what Client would send through the server,
+    // delivered on the main thread. Candidates of the offerer can overtake
+    // its offer; they wait until the answerer has the peer.
+    struct Candidate
+    {
+        QString candidate;
+        QString sdpMid;
+    };
+    QList<Candidate> earlyCandidates;
+    bool answererHasPeer = false;
+
+    QObject::connect(offerer.webrtc, &WebRTC::offerIsReady, &app, [&](const QString &, const QString &description) {
+        answerer.webrtc->addPeer(offererId);
+        answererHasPeer = true;
+        answerer.webrtc->setRemoteDescription(offererId, sdpOf(description));
+        answerer.webrtc->generateAnswerSDP(offererId);
+        for (const Candidate &early : std::as_const(earlyCandidates))
+            answerer.webrtc->setRemoteCandidate(offererId, early.candidate, early.sdpMid);
+        earlyCandidates.clear();
+    }, Qt::QueuedConnection);
+    QObject::connect(answerer.webrtc, &WebRTC::answerIsReady, &app, [&](const QString &, const QString &description) {
+        offerer.webrtc->setRemoteDescription(answererId, sdpOf(description));
+    }, Qt::QueuedConnection);
+    QObject::connect(offerer.webrtc, &WebRTC::localCandidateGenerated, &app,
+                     [&](const QString &, const QString &candidate, const QString &sdpMid) {
+        if (answererHasPeer)
+            answerer.webrtc->setRemoteCandidate(offererId, candidate, sdpMid);
+        else
+            earlyCandidates.append({candidate, sdpMid});
+    }, Qt::QueuedConnection);
+    QObject::connect(answerer.webrtc, &WebRTC::localCandidateGenerated, &app,
+                     [&](const QString &, const QString &candidate, const QString &sdpMid) {
+        offerer.webrtc->setRemoteCandidate(answererId, candidate, sdpMid);
+    }, Qt::QueuedConnection);
+
+    Snapshot begin;
+    const qint64 callStartNs = PipelineStage::clockNs();
+    qint64 setupNs = 0;
+    int connectedEnds = 0;
+
+    auto finish = [&]() {
+        const Snapshot end = takeSnapshot(offerer, offererId, answerer, answererId);
+        offerer.onsetPlayback->setMeasuring(false);
+        answerer.onsetPlayback->setMeasuring(false);
+
+        const double wallSeconds = double(end.wallNs - begin.wallNs) / 1e9;
+        const double cpuSeconds = double(end.cpu - begin.cpu) / CLOCKS_PER_SEC;
+        const quint64 packets = end.packetsSent - begin.packetsSent;
+
+        std::vector<qint64> latencies = offerer.onsetPlayback->latenciesUs();
+        const std::vector<qint64> answererLatencies = answerer.onsetPlayback->latenciesUs();
+        latencies.insert(latencies.end(), answererLatencies.begin(), answererLatencies.end());
+        const qint64 maxLatencyUs = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+
+        std::printf("profile             : %s, %.1f ms frames, %d bps\n", profileName.toUtf8().constData(),
+                    profile.frameDurationUs / 1000.0, profile.bitrate);
+        std::printf("call setup          : %.1f ms (offer to both ends connected)\n", setupNs / 1e6);
+        std::printf("measured            : %.1f s after %d s warm-up\n", wallSeconds, WarmupSeconds);
+        std::printf("packets/s           : %.1f sent, %.1f received (both directions)\n",
+                    packets / wallSeconds, (end.packetsReceived - begin.packetsReceived) / wallSeconds);
+        std::printf("mouth-to-ear ms     : p50 %.1f  p95 %.1f  max %.1f  (%zu bursts)\n",
+                    percentile(latencies, 0.50) / 1000.0, percentile(latencies, 0.95) / 1000.0,
+                    maxLatencyUs / 1000.0, latencies.size());
+        std::printf("CPU per call        : %.1f %% of one core (both ends)\n", 100.0 * cpuSeconds / wallSeconds);
+        std::printf("allocations/packet  : %.2f (counted at %s, whole process)\n",
+                    packets ? double(end.allocations - begin.allocations) / double(packets) : 0.0, allocationsCountedAt);
+        printEnd("bench-a", offerer);
+        printEnd("bench-b", answerer);
+
+        QCoreApplication::exit(latencies.empty() ? 1 : 0);
+    };
+
+    auto startMeasuring = [&]() {
+        offerer.sendPipeline.resetTimings();
+        answerer.sendPipeline.resetTimings();
+        offerer.onsetPlayback->setMeasuring(true);
+        answerer.onsetPlayback->setMeasuring(true);
+        begin = takeSnapshot(offerer, offererId, answerer, answererId);
+        QTimer::singleShot(seconds * 1000, &app, finish);
+    };
+
+    auto onOpened = [&](CallEnd &end) {
+        end.audioInput->start();
+        if (++connectedEnds == 2) {
+            setupNs = PipelineStage::clockNs() - callStartNs;
+            QTimer::singleShot(WarmupSeconds * 1000, &app, startMeasuring);
+        }
+    };
+    QObject::connect(offerer.webrtc, &WebRTC::openedDataChannel, &app, [&]() { onOpened(offerer); },
+                     Qt::QueuedConnection);
+    QObject::connect(answerer.webrtc, &WebRTC::openedDataChannel, &app, [&]() { onOpened(answerer); },
+                     Qt::QueuedConnection);
+
+    QTimer::singleShot(ConnectTimeoutMs, &app, [&]() {
+        if (connectedEnds < 2) {
+            std::printf("Peers did not connect within %d ms\n", ConnectTimeoutMs);
+            QCoreApplication::exit(1);
+        }
+    });
+
+    offerer.webrtc->addPeer(answererId);
+    offerer.webrtc->generateOfferSDP(answererId);
+
+    return app.exec();
+}
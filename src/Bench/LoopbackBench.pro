@@ -0,0 +1,18 @@
+QT       -= gui
+QT       += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = LoopbackBench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    LoopbackBench.cpp
+
+HEADERS += \
+    AllocationCounter.h
+
+# The real engine: capture, Opus, RTP, libdatachannel and playout.
+include(../engine.pri)
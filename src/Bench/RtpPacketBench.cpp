@@ -0,0 +1,215 @@
+// Micro-benchmark for the RTP module.
+//
+// Checks the wire format first (a header with CSRCs, an extension and
+// padding must survive a write/parse round trip, the sequence unwrapper
+// must count a wrap-around, DTX gaps must advance the timestamp and set
+// the marker) and the receive side's jitter buffer (reordering,
+// duplicates, late packets, losses, trimming and the adaptive target),
+// then times header write, packet parse and sequence unwrapping in tight
+// loops.
+//
+// Usage: RtpPacketBench [iterations, default 10000000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Audio/JitterBuffer.h"
+#include "Network/RtpPacket.h"
+
+using Clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    if (!condition) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+static void checkWireFormat()
+{
+    const unsigned char extension[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    RtpHeader header;
+    header.marker = true;
+    header.payloadType = 111;
+    header.sequenceNumber = 0xfffe;
+    header.timestamp = 0x89abcdef;
+    header.ssrc = 0x01020304;
+    header.csrcCount = 2;
+    header.csrcs[0] = 0x11111111;
+    header.csrcs[1] = 0x22222222;
+    header.hasExtension = true;
+    header.extensionProfile = 0xbede;
+    header.extensionData = extension;
+    header.extensionSize = sizeof(extension);
+
+    unsigned char packet[64] = {};
+    const int headerSize = header.write(packet, sizeof(packet));
+    check(headerSize == 12 + 8 + 4 + 8, "header size with CSRCs and extension");
+    check(packet[0] == 0x92 && packet[1] == 0xef, "first two header bytes");
+    check(packet[2] == 0xff && packet[3] == 0xfe, "sequence number is big endian");
+    check(header.write(packet, headerSize - 1) == 0, "write refuses a short buffer");
+
+    // Three payload bytes and four bytes of padding.
+    std::memcpy(packet + headerSize, "abc", 3);
+    packet[0] |= 0x20;
+    packet[headerSize + 6] = 4;
+    const int size = headerSize + 7;
+
+    RtpPacket parsed;
+    check(parsed.parse(packet, size), "parse a full packet");
+    check(parsed.header.marker && parsed.header.payloadType == 111, "marker and payload type");
+    check(parsed.header.sequenceNumber == 0xfffe && parsed.header.timestamp == 0x89abcdef
+              && parsed.header.ssrc == 0x01020304, "sequence, timestamp and SSRC");
+    check(parsed.header.csrcCount == 2 && parsed.header.csrcs[1] == 0x22222222, "CSRC list");
+    check(parsed.header.extensionProfile == 0xbede && parsed.header.extensionSize == 8
+              && std::memcmp(parsed.header.extensionData, extension, 8) == 0, "header extension");
+    check(parsed.paddingSize == 4 && parsed.payloadSize == 3
+              && std::memcmp(parsed.payload, "abc", 3) == 0, "payload without padding");
+    check(!parsed.parse(packet, headerSize - 1), "reject a truncated extension");
+
+    packet[0] = 0x40;
+    check(!parsed.parse(packet, size), "reject RTP version 1");
+
+    const unsigned char receiverReport[8] = {0x81, 201, 0, 1, 0, 0, 0, 1};
+    check(RtpPacket::isRtcp(receiverReport, sizeof(receiverReport)), "muxed RTCP is recognised");
+
+    SequenceUnwrapper unwrapper;
+    check(unwrapper.unwrap(65534) == 65534, "first sequence number");
+    check(unwrapper.unwrap(1) == 65537, "wrap-around");
+    check(unwrapper.unwrap(65535) == 65535, "late packet from before the wrap");
+    check(unwrapper.highest() == 65537, "highest extended sequence");
+
+    RtpTimestamper timestamper(1000);
+    bool marker = false;
+    check(timestamper.timestamp(0, 960, &marker) == 1000 && marker, "first packet is marked");
+    check(timestamper.timestamp(960, 960, &marker) == 1960 && !marker, "contiguous frame");
+    check(timestamper.timestamp(4800, 960, &marker) == 5800 && marker, "DTX gap advances and marks");
+}
+
+// 20 ms frames on the 48 kHz RTP clock, arriving on time at
+// sequenceNumber * 20 ms unless an arrival time is given.
+static constexpr int FrameSamples = 960;
+static constexpr qint64 FrameUs = 20000;
+
+static bool insertFrame(JitterBuffer &buffer, quint16 sequenceNumber, qint64 arrivalUs)
+{
+    const char payload[3] = {1, 2, 3};
+    return buffer.insert(sequenceNumber, quint32(sequenceNumber) * FrameSamples, FrameSamples,
+                         payload, sizeof(payload), arrivalUs);
+}
+
+static bool insertFrame(JitterBuffer &buffer, quint16 sequenceNumber)
+{
+    return insertFrame(buffer, sequenceNumber, qint64(sequenceNumber) * FrameUs);
+}
+
+// Sequence number of the frame pop() hands out, -1 for a loss and -2
+// while buffering.
+static int popFrame(JitterBuffer &buffer)
+{
+    const JitterBuffer::Packet *packet = nullptr;
+    switch (buffer.pop(&packet)) {
+    case JitterBuffer::Status::Ready:
+        return packet->sequenceNumber;
+    case JitterBuffer::Status::Missing:
+        return -1;
+    case JitterBuffer::Status::Buffering:
+        break;
+    }
+    return -2;
+}
+
+static void checkJitterBuffer()
+{
+    JitterBuffer buffer;
+    check(insertFrame(buffer, 10), "insert the first packet");
+    check(insertFrame(buffer, 12), "insert a packet ahead of a gap");
+    check(insertFrame(buffer, 11, 241000), "insert a reordered packet");
+    check(!insertFrame(buffer, 11, 242000) && buffer.duplicatePackets() == 1, "reject a duplicate");
+    check(buffer.bufferedMs() == 60, "buffered duration in RTP clock ticks");
+    check(popFrame(buffer) == 10 && popFrame(buffer) == 11 && popFrame(buffer) == 12,
+          "reordered packets play in sequence");
+    check(!insertFrame(buffer, 11) && buffer.latePackets() == 1, "reject a packet that was already played");
+
+    check(insertFrame(buffer, 14) && insertFrame(buffer, 15), "insert after a lost packet");
+    check(popFrame(buffer) == -1 && buffer.missingPackets() == 1, "declare the gap lost once the buffer is full");
+    check(popFrame(buffer) == 14 && popFrame(buffer) == 15, "play on after the loss");
+    check(popFrame(buffer) == -2, "buffer again after an underrun");
+
+    // A stall delivers eight frames at once: play the newest ones and keep
+    // only the target delay plus two frames.
+    JitterBuffer burst;
+    for (quint16 sequenceNumber = 0; sequenceNumber < 8; ++sequenceNumber)
+        insertFrame(burst, sequenceNumber, 0);
+    check(popFrame(burst) > 0 && burst.discardedPackets() > 0, "trim a backlog");
+    check(burst.bufferedMs() <= burst.targetDelayMs() + 2 * 20, "trimmed down to the target");
+
+    // Frames 15 ms late every other packet raise the target; a steady
+    // stream brings it back to one frame.
+    JitterBuffer adaptive;
+    quint16 sequenceNumber = 0;
+    for (; sequenceNumber < 300; ++sequenceNumber) {
+        insertFrame(adaptive, sequenceNumber, qint64(sequenceNumber) * FrameUs + (sequenceNumber & 1) * 15000);
+        popFrame(adaptive);
+    }
+    check(adaptive.jitterMs() > 10.0 && adaptive.targetDelayMs() > 60, "jitter raises the target delay");
+    for (; sequenceNumber < 600; ++sequenceNumber) {
+        insertFrame(adaptive, sequenceNumber);
+        popFrame(adaptive);
+    }
+    check(adaptive.jitterMs() < 1.0 && adaptive.targetDelayMs() <= 25, "the target comes down once jitter settles");
+}
+
+template <typename Function>
+static double nsPerOperation(long long iterations, Function function)
+{
+    const auto start = Clock::now();
+    for (long long i = 0; i < iterations; ++i)
+        function(i);
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    const long long iterations = argc > 1 ? std::atoll(argv[1]) : 10000000;
+
+    checkWireFormat();
+    checkJitterBuffer();
+    if (failures)
+        return 1;
+
+    unsigned char packet[1200] = {};
+    RtpHeader header;
+    header.payloadType = 111;
+    header.ssrc = 0x5eed;
+    volatile unsigned sink = 0;
+
+    const double writeNs = nsPerOperation(iterations, [&](long long i) {
+        header.sequenceNumber = quint16(i);
+        header.timestamp = quint32(i * 960);
+        sink += header.write(packet, sizeof(packet));
+    });
+
+    const int packetSize = RtpHeader::FixedSize + 160;
+    RtpPacket parsed;
+    const double parseNs = nsPerOperation(iterations, [&](long long i) {
+        packet[3] = static_cast<unsigned char>(i);
+        sink += parsed.parse(packet, packetSize) ? parsed.header.sequenceNumber : 0;
+    });
+
+    SequenceUnwrapper unwrapper;
+    const double unwrapNs = nsPerOperation(iterations, [&](long long i) {
+        sink += unwrapper.unwrap(quint16(i));
+    });
+
+    std::printf("iterations      : %lld (wire format and jitter buffer checks passed)\n", iterations);
+    std::printf("header write    : %.2f ns\n", writeNs);
+    std::printf("packet parse    : %.2f ns\n", parseNs);
+    std::printf("sequence unwrap : %.2f ns  (highest %u)\n", unwrapNs, unwrapper.highest());
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+QT       -= gui
+QT       += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = RtpPacketBench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    RtpPacketBench.cpp \
+    ../Audio/JitterBuffer.cpp \
+    ../Network/RtpPacket.cpp
+
+HEADERS += \
+    ../Audio/JitterBuffer.h \
+    ../Network/RtpPacket.h
@@ -0,0 +1,180 @@
+// Allocation benchmark for the RTP send path.
+//
+// Encodes a 440 Hz tone frame by frame and packetizes every Opus packet
+// twice: once the way the send path used to (per frame QByteArray from the
+// encoder, QByteArray header + append, std::transform into a fresh vector
+// passed by value) and once through the real pipeline: OpusEncoderStage
+// encodes into a pooled frame, RtpSenderStage writes the header into its
+// headroom and RtpStream::send() caches and sends it, to two peers like
+// WebRTC::broadcastPacket(). Only the track is replaced, by an RtpStream
+// whose transmit() just reads the packet, so libdatachannel's own copy of
+// the message is not part of the numbers.
+//
+// Usage: RtpSendBench [frames, default 50000]
+
+#include <QByteArray>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "opus.h"
+#include "Audio/OpusEncoderStage.h"
+#include "Bench/AllocationCounter.h"
+#include "Network/RtpPacket.h"
+#include "Network/RtpSenderStage.h"
+#include "Network/RtpStream.h"
+#include "Pipeline/MediaFrame.h"
+
+static unsigned long long checksum = 0;
+
+static bool sendVariant(rtc::message_variant data)
+{
+    const rtc::binary &packet = std::get<rtc::binary>(data);
+    checksum += std::to_integer<unsigned>(packet.back());
+    return true;
+}
+
+// A peer's stream with the track left out.
+class BenchStream : public RtpStream
+{
+public:
+    explicit BenchStream(quint32 ssrc) : RtpStream(nullptr, ssrc, 111) {}
+
+protected:
+    bool transmit(const std::byte *packet, int size) override
+    {
+        checksum += std::to_integer<unsigned>(packet[size - 1]);
+        return true;
+    }
+};
+
+static void writeHeader(std::byte *packet, quint16 sequenceNumber, quint32 timestamp)
+{
+    RtpHeader header;
+    header.payloadType = 111;
+    header.sequenceNumber = sequenceNumber;
+    header.timestamp = timestamp;
+    header.ssrc = 2;
+    header.write(reinterpret_cast<unsigned char *>(packet), RtpHeader::FixedSize);
+}
+
+struct Result {
+    unsigned long long allocations = 0;
+    unsigned long long packets = 0;
+    std::vector<long long> packetizeNs;
+};
+
+static long long percentile(std::vector<long long> values, double p)
+{
+    if (values.empty())
+        return 0;
+    const std::size_t index = std::min(values.size() - 1, std::size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int sampleRate = 48000;
+    const int frameSize = 960;
+    const int maxPacketSize = 4000;
+
+    int error = 0;
+    OpusEncoder *legacyEncoder = opus_encoder_create(sampleRate, 1, OPUS_APPLICATION_AUDIO, &error);
+    if (error != OPUS_OK) {
+        std::printf("Failed to create Opus encoder: %s\n", opus_strerror(error));
+        return 1;
+    }
+
+    std::vector<opus_int16> pcm(frameSize);
+
+    FramePool<qint16> pcmPool(4, frameSize);
+    OpusEncoderStage encoder(sampleRate, 1, RtpSenderStage::Headroom, RtpSenderStage::MaxPayloadSize);
+    std::array<BenchStream, 2> streams = {BenchStream(1), BenchStream(2)};
+    RtpSenderStage sender([&streams](std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples) {
+        for (BenchStream &stream : streams)
+            stream.send(packet, capacity, payloadSize, samplePosition, frameSamples);
+    });
+    encoder.output().connect(sender.input());
+
+    Result legacy;
+    Result pipeline;
+    legacy.packetizeNs.reserve(frames);
+    pipeline.packetizeNs.reserve(frames);
+
+    for (int frame = 0; frame < frames; ++frame) {
+        for (int i = 0; i < frameSize; ++i) {
+            const double t = double(frame * frameSize + i) / sampleRate;
+            pcm[i] = opus_int16(8000 * std::sin(2 * 3.14159265358979 * 440 * t));
+        }
+        const quint16 sequenceNumber = quint16(frame);
+        const quint32 timestamp = quint32(frame * frameSize);
+
+        // Before: encoder output, header and payload in three buffers.
+        unsigned long long before = allocationCount.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        {
+            QByteArray encodedData(maxPacketSize, 0);
+            int encodedBytes = opus_encode(legacyEncoder, pcm.data(), frameSize,
+                                           reinterpret_cast<unsigned char *>(encodedData.data()), maxPacketSize);
+            encodedData.resize(encodedBytes);
+
+            std::byte header[RtpHeader::FixedSize];
+            writeHeader(header, sequenceNumber, timestamp);
+            QByteArray rtpPacket;
+            rtpPacket.append(reinterpret_cast<const char *>(header), sizeof(header));
+            rtpPacket.append(encodedData);
+
+            std::vector<std::byte> packetData(rtpPacket.size());
+            std::transform(rtpPacket.begin(), rtpPacket.end(), packetData.begin(), [](char c) {
+                return static_cast<std::byte>(c);
+            });
+            sendVariant(packetData);
+        }
+        legacy.packetizeNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        legacy.allocations += allocationCount.load(std::memory_order_relaxed) - before;
+        ++legacy.packets;
+
+        // After: one pooled frame from the encoder to the track.
+        FrameRef<qint16> pcmFrame = pcmPool.acquire();
+        std::memcpy(pcmFrame->data(), pcm.data(), pcm.size() * sizeof(opus_int16));
+        pcmFrame->setSize(frameSize);
+        pcmFrame->samplePosition = quint64(frame) * frameSize;
+        pcmFrame->frameSamples = frameSize;
+
+        before = allocationCount.load(std::memory_order_relaxed);
+        start = Clock::now();
+        encoder.input().receive(pcmFrame);
+        pipeline.packetizeNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        pipeline.allocations += allocationCount.load(std::memory_order_relaxed) - before;
+        ++pipeline.packets;
+    }
+
+    opus_encoder_destroy(legacyEncoder);
+
+    std::printf("frames            : %d x 20 ms, allocations counted at %s\n", frames, allocationsCountedAt);
+    std::printf("                    allocs/packet  encode+send ns p50   p99\n");
+    std::printf("QByteArray path   : %13.2f  %18lld  %5lld\n",
+                double(legacy.allocations) / legacy.packets,
+                percentile(legacy.packetizeNs, 0.50), percentile(legacy.packetizeNs, 0.99));
+    std::printf("pipeline path     : %13.2f  %18lld  %5lld\n",
+                double(pipeline.allocations) / pipeline.packets,
+                percentile(pipeline.packetizeNs, 0.50), percentile(pipeline.packetizeNs, 0.99));
+    std::printf("(checksum %llu)\n", checksum);
+
+    // Every frame must have reached both peers, without a single allocation.
+    bool sentAll = encoder.droppedFrames() == 0 && sender.rejectedFrames() == 0;
+    for (const BenchStream &stream : streams)
+        sentAll = sentAll && stream.packetsSent() == quint64(frames);
+    if (!sentAll)
+        std::printf("FAIL: frames were dropped or rejected on the pipeline path\n");
+
+    return sentAll && pipeline.allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+QT       -= gui
+QT       += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = RtpSendBench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    RtpSendBench.cpp
+
+HEADERS += \
+    AllocationCounter.h
+
+# OpusEncoderStage, RtpSenderStage and RtpStream as the application uses them.
+include(../engine.pri)
@@ -0,0 +1,122 @@
+// Stress benchmark for the network -> playout receive queue.
+//
+// A producer thread plays the libdatachannel callback and pushes 20 ms
+// packets at a multiple of the normal 50 packets/s; a consumer thread
+// plays the audio sink and drains the queue into a JitterBuffer once per
+// 10 ms device period, exactly like PlayoutDevice::readData does.
+//
+// Usage: SpscQueueBench [rate multiplier, default 10] [seconds, default 10]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "Audio/ReceiveQueue.h"
+
+using Clock = std::chrono::steady_clock;
+
+static qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static qint64 percentile(std::vector<qint64> &values, double p)
+{
+    if (values.empty())
+        return 0;
+    const std::size_t index = std::min(values.size() - 1, std::size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char *argv[])
+{
+    const int multiplier = argc > 1 ? std::atoi(argv[1]) : 10;
+    const int seconds = argc > 2 ? std::atoi(argv[2]) : 10;
+    const int packetsPerSecond = 50 * multiplier;
+    const int totalPackets = packetsPerSecond * seconds;
+    const int payloadSize = 160;
+    const int frameSamples = 960;
+
+    static ReceiveQueue queue;
+    static JitterBuffer jitter;
+    std::atomic<bool> producerDone{false};
+    std::atomic<quint64> drops{0};
+    std::vector<qint64> pushNs;
+    std::vector<qint64> drainUs;
+    std::size_t maxDepth = 0;
+    quint64 received = 0;
+    pushNs.reserve(totalPackets);
+
+    std::thread consumer([&] {
+        auto nextPeriod = Clock::now();
+        while (true) {
+            nextPeriod += std::chrono::milliseconds(10);
+            std::this_thread::sleep_until(nextPeriod);
+
+            const bool done = producerDone.load(std::memory_order_acquire);
+            const auto start = Clock::now();
+            maxDepth = std::max(maxDepth, queue.size());
+            while (const ReceivedPacket *packet = queue.front()) {
+                jitter.insert(packet->sequenceNumber, packet->timestamp, packet->samples,
+                              reinterpret_cast<const char *>(packet->payload), packet->size, packet->arrivalUs);
+                queue.pop();
+                ++received;
+            }
+            // One device period worth of playout.
+            const JitterBuffer::Packet *packet = nullptr;
+            jitter.pop(&packet);
+            drainUs.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+
+            if (done && queue.size() == 0)
+                break;
+        }
+    });
+
+    unsigned char payload[payloadSize];
+    std::memset(payload, 0x5a, sizeof(payload));
+
+    const auto interval = std::chrono::nanoseconds(1000000000LL / packetsPerSecond);
+    auto nextSend = Clock::now();
+    for (int i = 0; i < totalPackets; ++i) {
+        nextSend += interval;
+        std::this_thread::sleep_until(nextSend);
+
+        const auto start = Clock::now();
+        ReceivedPacket *slot = queue.beginPush();
+        if (!slot) {
+            drops.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            slot->sequenceNumber = quint16(i);
+            slot->timestamp = quint32(i * frameSamples);
+            slot->samples = frameSamples;
+            slot->arrivalUs = nowUs();
+            slot->size = payloadSize;
+            std::memcpy(slot->payload, payload, payloadSize);
+            queue.endPush();
+        }
+        pushNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    producerDone.store(true, std::memory_order_release);
+    consumer.join();
+
+    std::printf("rate            : %d packets/s (%dx normal) for %d s\n", packetsPerSecond, multiplier, seconds);
+    std::printf("queue capacity  : %zu slots\n", ReceiveQueue::capacity());
+    std::printf("sent / received : %d / %llu\n", totalPackets, static_cast<unsigned long long>(received));
+    std::printf("drops (full)    : %llu\n", static_cast<unsigned long long>(drops.load()));
+    std::printf("max queue depth : %zu\n", maxDepth);
+    std::printf("push latency ns : p50 %lld  p99 %lld  max %lld\n",
+                static_cast<long long>(percentile(pushNs, 0.50)),
+                static_cast<long long>(percentile(pushNs, 0.99)),
+                static_cast<long long>(*std::max_element(pushNs.begin(), pushNs.end())));
+    std::printf("drain time us   : p50 %lld  p99 %lld  max %lld\n",
+                static_cast<long long>(percentile(drainUs, 0.50)),
+                static_cast<long long>(percentile(drainUs, 0.99)),
+                static_cast<long long>(*std::max_element(drainUs.begin(), drainUs.end())));
+
+    return drops.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+QT       -= gui
+QT       += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = SpscQueueBench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    SpscQueueBench.cpp \
+    ../Audio/JitterBuffer.cpp
+
+HEADERS += \
+    ../Audio/JitterBuffer.h \
+    ../Audio/ReceiveQueue.h \
+    ../Utils/SpscQueue.h
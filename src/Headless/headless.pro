@@ -0,0 +1,15 @@
+QT       -= gui
+QT       += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = CallEngine
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    main.cpp
+
+# No Qt Quick, QML or widgets: only the engine and its dependencies.
+include(../engine.pri)
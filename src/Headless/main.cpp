@@ -0,0 +1,123 @@
+// Call engine without QML or a window, for unattended endpoints and
+// benchmark rigs. Runs one Client under QCoreApplication; everything the
+// GUI would choose comes from the command line.
+//
+// Answerer: CallEngine --id peer2 --peer peer1
+// Offerer:  CallEngine --offerer --id peer1 --peer peer2 --profile voice --duration 60
+// No sound card: add --input speech.wav --loop --output null (or received.wav)
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QTimer>
+#include "Audio/FileCapture.h"
+#include "Audio/FilePlayback.h"
+#include "Network/Client.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("CallEngine");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless voice call engine");
+    parser.addHelpOption();
+
+    const QCommandLineOption offererOption("offerer", "Place the call instead of waiting for one.");
+    const QCommandLineOption idOption("id", "Own peer ID (default: peer1 as offerer, peer2 otherwise).", "id");
+    const QCommandLineOption peerOption("peer", "Peer ID to call (default: the other of peer1 and peer2).", "id");
+    const QCommandLineOption serverOption("server", "Signaling server URL.", "url", "https://localhost:8080");
+    const QCommandLineOption profileOption("profile", "Encoder profile: music, voice, low-latency or low-cpu.",
+                                           "name", "music");
+    const QCommandLineOption bitrateOption("bitrate", "Opus bitrate in bits per second.", "bps");
+    const QCommandLineOption frameOption("frame-ms", "Opus frame duration: 2.5, 5, 10, 20, 40 or 60.", "ms");
+    const QCommandLineOption complexityOption("complexity", "Opus complexity, 0 to 10.", "level");
+    const QCommandLineOption fecOption("fec", "Send in-band FEC.");
+    const QCommandLineOption dtxOption("dtx", "Discontinuous transmission during silence.");
+    const QCommandLineOption lanOption("lan", "Host candidates only, no STUN (LAN and loopback calls).");
+    const QCommandLineOption delayOption("call-delay", "Offerer: wait this long after connecting before calling.",
+                                         "ms", "1000");
+    const QCommandLineOption durationOption("duration", "Hang up and exit after this many seconds; 0 runs until killed.",
+                                            "s", "0");
+    const QCommandLineOption inputOption("input", "Capture from a WAV or raw 48 kHz mono 16-bit file.", "file");
+    const QCommandLineOption fastOption("fast", "Read the input file as fast as the encoder takes it.");
+    const QCommandLineOption loopOption("loop", "Start the input file over when it ends.");
+    const QCommandLineOption outputOption("output", "Play into a WAV or raw file, or \"null\" to discard.", "file");
+    parser.addOptions({offererOption, idOption, peerOption, serverOption, profileOption, bitrateOption, frameOption,
+                       complexityOption, fecOption, dtxOption, lanOption, delayOption, durationOption,
+                       inputOption, fastOption, loopOption, outputOption});
+    parser.process(app);
+
+    const bool isOfferer = parser.isSet(offererOption);
+    const QString id = parser.isSet(idOption) ? parser.value(idOption) : QString(isOfferer ? "peer1" : "peer2");
+    const QString peerId = parser.isSet(peerOption) ? parser.value(peerOption) : QString(isOfferer ? "peer2" : "peer1");
+
+    EncoderProfile profile;
+    if (!EncoderProfile::fromName(parser.value(profileOption), &profile)) {
+        qWarning() << "Unknown encoder profile:" << parser.value(profileOption);
+        return 1;
+    }
+    if (parser.isSet(bitrateOption)) {
+        profile.bitrate = parser.value(bitrateOption).toInt();
+    }
+    if (parser.isSet(frameOption)) {
+        profile.frameDurationUs = qRound(parser.value(frameOption).toDouble() * 1000.0);
+    }
+    if (parser.isSet(complexityOption)) {
+        profile.complexity = parser.value(complexityOption).toInt();
+    }
+    if (parser.isSet(fecOption)) {
+        profile.inbandFec = true;
+    }
+    if (parser.isSet(dtxOption)) {
+        profile.dtx = true;
+    }
+    if (!profile.isValid()) {
+        qWarning() << "Invalid codec settings";
+        return 1;
+    }
+
+    Client client(nullptr, parser.value(serverOption).toStdString(), id, isOfferer, peerId);
+    client.setEncoderProfile(profile);
+    if (parser.isSet(lanOption)) {
+        client.setIceSettings(IceSettings::hostOnlyLan());
+    }
+    if (parser.isSet(inputOption)) {
+        const FileCapture::Pacing pacing = parser.isSet(fastOption) ? FileCapture::Pacing::AsFastAsPossible
+                                                                    : FileCapture::Pacing::RealTime;
+        client.setCaptureEndpoint(std::make_unique<FileCapture>(parser.value(inputOption), client.captureFormat(),
+                                                                pacing, parser.isSet(loopOption)));
+    }
+    if (parser.isSet(outputOption)) {
+        const QString output = parser.value(outputOption);
+        if (output == "null") {
+            client.setPlaybackEndpoint(std::make_unique<NullPlayback>(client.playbackFormat()));
+        } else {
+            client.setPlaybackEndpoint(std::make_unique<FilePlayback>(output, client.playbackFormat()));
+        }
+    }
+
+    if (isOfferer) {
+        const int delayMs = parser.value(delayOption).toInt();
+        QObject::connect(&client, &Client::signalingConnected, &client, [&client, peerId, delayMs]() {
+            // A reconnect of the signaling socket does not start a second call.
+            QTimer::singleShot(delayMs, &client, [&client, peerId]() {
+                if (client.state() == Client::CallState::Idle) {
+                    client.startCall(peerId);
+                }
+            });
+        }, Qt::QueuedConnection);
+    }
+
+    QObject::connect(&client, &Client::shutdownFinished, &app, [&client]() {
+        qInfo() << "Send pipeline:" << client.sendPipelineStats();
+        QCoreApplication::quit();
+    });
+
+    const int durationS = parser.value(durationOption).toInt();
+    if (durationS > 0) {
+        QTimer::singleShot(durationS * 1000, &client, [&client]() { client.shutdown(); });
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,109 @@
+#include "BitrateController.h"
+#include <QDebug>
+#include <QtGlobal>
+#include <cmath>
+
+// Thresholds follow the loss-based half of Google Congestion Control.
+static constexpr double LowLossThreshold = 0.02;
+static constexpr double HighLossThreshold = 0.10;
+static constexpr double IncreaseFactor = 1.08;
+static constexpr double DelayBackoffFactor = 0.85;
+// Queueing delay on top of the lowest RTT seen before we call it congestion.
+static constexpr int QueueingDelayThresholdMs = 100;
+// Do not run further ahead of what the receiver reports getting.
+static constexpr double ReceiveRateHeadroom = 1.5;
+
+BitrateController::BitrateController(QObject *parent)
+    : QObject{parent}
+{}
+
+void BitrateController::setBitrateRange(int minBitrate, int maxBitrate)
+{
+    m_minBitrate = minBitrate;
+    m_maxBitrate = qMax(minBitrate, maxBitrate);
+    m_bitrate = qBound(m_minBitrate, m_bitrate, m_maxBitrate);
+}
+
+void BitrateController::reset(int startBitrate)
+{
+    m_bitrate = qBound(m_minBitrate, startBitrate, m_maxBitrate);
+    m_packetLossPercent = 0;
+    m_smoothedLoss = 0.0;
+    m_reports.clear();
+}
+
+void BitrateController::addReport(const QString &peerId, double fractionLost, int rttMs, int receiveRate)
+{
+    PeerReport &report = m_reports[peerId];
+    report.fractionLost = fractionLost;
+    report.rttMs = rttMs;
+    report.receiveRate = receiveRate;
+    report.pending = true;
+    if (rttMs >= 0 && (report.minRttMs < 0 || rttMs < report.minRttMs))
+        report.minRttMs = rttMs;
+}
+
+void BitrateController::removePeer(const QString &peerId)
+{
+    m_reports.remove(peerId);
+}
+
+void BitrateController::update()
+{
+    // A far away peer has a high RTT, not a queue: compare each peer with
+    // its own floor and take the worst rise.
+    bool hasReport = false;
+    double fractionLost = 0.0;
+    int queueingDelayMs = -1;
+    int receiveRate = 0;
+
+    for (PeerReport &report : m_reports) {
+        if (!report.pending)
+            continue;
+        report.pending = false;
+        hasReport = true;
+
+        fractionLost = qMax(fractionLost, report.fractionLost);
+        if (report.rttMs >= 0)
+            queueingDelayMs = qMax(queueingDelayMs, report.rttMs - report.minRttMs);
+        if (report.receiveRate > 0 && (receiveRate == 0 || report.receiveRate < receiveRate))
+            receiveRate = report.receiveRate;
+    }
+
+    if (hasReport)
+        onFeedback(fractionLost, queueingDelayMs, receiveRate);
+}
+
+void BitrateController::onFeedback(double fractionLost, int queueingDelayMs, int receiveRate)
+{
+    fractionLost = qBound(0.0, fractionLost, 1.0);
+    m_smoothedLoss = 0.7 * m_smoothedLoss + 0.3 * fractionLost;
+
+    const bool queueBuilding = queueingDelayMs > QueueingDelayThresholdMs;
+
+    double target = m_bitrate;
+    if (fractionLost > HighLossThreshold)
+        target *= 1.0 - 0.5 * fractionLost;
+    else if (queueBuilding)
+        target *= DelayBackoffFactor;
+    else if (fractionLost < LowLossThreshold)
+        target *= IncreaseFactor;
+
+    if (receiveRate > 0)
+        target = qMin(target, receiveRate * ReceiveRateHeadroom);
+
+    const int bitrate = qBound(m_minBitrate, int(std::lround(target)), m_maxBitrate);
+    const int lossPercent = qBound(0, int(std::lround(m_smoothedLoss * 100.0)), 100);
+
+    // Ignore tiny steps so the encoder is not reconfigured on every report,
+    // but still let the rate settle exactly on its limits.
+    const bool smallStep = qAbs(bitrate - m_bitrate) < m_bitrate / 20
+                           && bitrate != m_minBitrate && bitrate != m_maxBitrate;
+    if ((bitrate == m_bitrate || smallStep) && lossPercent == m_packetLossPercent)
+        return;
+
+    m_bitrate = bitrate;
+    m_packetLossPercent = lossPercent;
+    qDebug() << "Bitrate controller: target" << m_bitrate << "bps, expected loss" << m_packetLossPercent << "%";
+    Q_EMIT targetChanged(m_bitrate, m_packetLossPercent);
+}
@@ -0,0 +1,68 @@
+#ifndef BITRATECONTROLLER_H
+#define BITRATECONTROLLER_H
+
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+/**
+ * Loss and delay based sender-side rate control for the Opus encoder.
+ *
+ * Receiver reports (fraction lost, round-trip time and the rate the
+ * receiver actually sees) are collected per peer and folded into one step
+ * per RTCP interval. Every peer gets the same encoded stream, so the worst
+ * link decides: heavy loss, or a round-trip time that grows well above
+ * that peer's own floor (a queue is building), backs the rate off. Only
+ * when every link is clean does the rate grow again, up to the profile
+ * maximum and never far beyond what the slowest receiver gets.
+ */
+class BitrateController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BitrateController(QObject *parent = nullptr);
+
+    int bitrate() const { return m_bitrate; }
+    int packetLossPercent() const { return m_packetLossPercent; }
+
+    void setBitrateRange(int minBitrate, int maxBitrate);
+    void reset(int startBitrate);
+
+    // The latest receiver report of a peer, held until update().
+    // fractionLost: 0.0 - 1.0 since the peer's previous report, rttMs < 0 if
+    // unknown, receiveRate: bits per second seen by the peer, 0 if unknown.
+    void addReport(const QString &peerId, double fractionLost, int rttMs, int receiveRate);
+    // Forgets a peer that left the call, with its RTT floor.
+    void removePeer(const QString &peerId);
+    // Once per report interval: one onFeedback() step from the reports that
+    // arrived since the last update.
+    void update();
+
+public Q_SLOTS:
+    // The combined feedback of all peers. queueingDelayMs: round-trip time
+    // above its floor, < 0 if unknown.
+    void onFeedback(double fractionLost, int queueingDelayMs, int receiveRate);
+
+Q_SIGNALS:
+    void targetChanged(int bitrate, int packetLossPercent);
+
+private:
+    struct PeerReport
+    {
+        double  fractionLost = 0.0;
+        int     rttMs = -1;
+        int     minRttMs = -1;      // this peer's floor, kept across reports
+        int     receiveRate = 0;
+        bool    pending = false;    // not folded into a step yet
+    };
+
+    QMap<QString, PeerReport> m_reports;
+    int     m_minBitrate = 6000;
+    int     m_maxBitrate = 48000;
+    int     m_bitrate = 48000;
+    int     m_packetLossPercent = 0;
+    double  m_smoothedLoss = 0.0;
+};
+
+#endif
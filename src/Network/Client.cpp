@@ -2,21 +2,51 @@
 #include <QDebug>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThreadPool>
 
 Client::Client(QObject *parent, string serverUrl_, QString id_, bool isOfferer_, QString peerId) : QObject(parent)
 {
     webrtc = new WebRTC (this);
     audioInput = new AudioInput(this);
+    // The encoder leaves room for the RTP header in front of every packet,
+    // so the sender sends the encoder's buffer as is.
+    encoder = new OpusEncoderStage(audioInput->sampleRate(), audioInput->channelCount(),
+                                   RtpSenderStage::Headroom, RtpSenderStage::MaxPayloadSize);
+    rtpSender = new RtpSenderStage(webrtc);
     audioOutput = new AudioOutput();
+    bitrateController = new BitrateController(this);
     id = id_;
     isOfferer = isOfferer_;
     peerId_ = peerId;
 
     connect(webrtc, &WebRTC::offerIsReady, this, &Client::onOfferIsReady);
     connect(webrtc, &WebRTC::answerIsReady, this, &Client::onAnswerIsReady);
+    connect(webrtc, &WebRTC::localCandidateGenerated, this, &Client::onLocalCandidateGenerated);
     connect(webrtc, &WebRTC::openedDataChannel, this, &Client::onOpenedDataChannel);
-    connect(audioInput, &AudioInput::dataReady, this, &Client::onDataReady);
-    connect(webrtc, &WebRTC::incommingPacket, this, &Client::onIncommingPacket);
+    connect(webrtc, &WebRTC::peerClosed, this, &Client::onPeerClosed);
+    // Capture, encode and send all run on the capture thread, one frame
+    // at a time, instead of bouncing through the GUI loop. Further
+    // processing (gain, recording, ...) goes in as another stage.
+    sendPipeline.addStage(audioInput);
+    sendPipeline.link(audioInput->output(), encoder->input());
+    sendPipeline.link(encoder->output(), rtpSender->input());
+    // Received frames go from the network thread straight to playout.
+    webrtc->setReceivedFrameSink(audioOutput);
+    connect(webrtc, &WebRTC::networkFeedback, this, &Client::onNetworkFeedback);
+    connect(webrtc, &WebRTC::callStatsChanged, this, [this]() {
+        // One rate step per report interval from every peer's report.
+        bitrateController->update();
+
+        // NACKs are only useful while the resent packet can still be played.
+        const int targetDelayMs = audioOutput->stats().targetDelayMs;
+        if (targetDelayMs > 0) {
+            webrtc->setPlayoutDelayMs(targetDelayMs);
+        }
+    });
+    connect(bitrateController, &BitrateController::targetChanged, this, [this](int bitrate, int packetLossPercent) {
+        encoder->setNetworkTarget(bitrate, packetLossPercent);
+    });
+    setEncoderProfile(encoder->profile());
 
     socket.set_open_listener([this]() { onConnected(); });
     socket.set_close_listener([](sio::client::close_reason const& reason) {
@@ -30,7 +60,12 @@ Client::Client(QObject *parent, string serverUrl_, QString id_, bool isOfferer_,
     socket.socket()->on("message", sio::socket::event_listener_aux(
                                         [this](const std::string& name, const std::shared_ptr<sio::message>& data, bool hasAck, sio::message::list &ack_resp) {
                                             if (data) {
-                                                onMessageReceived(data->get_string());
+                                                // Peers are added and removed on the
+                                                // engine's thread, not the socket's.
+                                                const std::string message = data->get_string();
+                                                QMetaObject::invokeMethod(this, [this, message]() {
+                                                    onMessageReceived(message);
+                                                }, Qt::QueuedConnection);
                                             }
                                         }
                                         ));
@@ -43,9 +78,15 @@ Client::~Client()
 {
     socket.close();
 
+    // Stop the threads that call into the others first: the encoder sends
+    // through webrtc, and webrtc's network threads write into audioOutput
+    // until its peer connections are gone.
+    audioInput->stop();
+    delete webrtc;
     delete audioInput;
+    delete rtpSender;
+    delete encoder;
     delete audioOutput;
-    delete webrtc;
 
     mutex.lock();
     mutex.unlock();
@@ -68,14 +109,149 @@ void Client::sendRegisterRequest()
 void Client::onConnected()
 {
     qDebug() << "Connected to signaling server";
+    Q_EMIT signalingConnected();
 }
 
 void Client::startCall (QString peerId)
 {
+    // Peers of the previous call may still be closing; they do not hold
+    // up the new one.
+    peerId_ = peerId;
+    setCallState(CallState::Active);
     webrtc->addPeer(peerId);
     webrtc->generateOfferSDP(peerId);
 }
 
+void Client::endCall()
+{
+    const QStringList peers = webrtc->peerIds();
+    for (const QString &peer : peers) {
+        sendHangup(peer);
+        closePeer(peer);
+    }
+    finishCall();
+}
+
+void Client::shutdown()
+{
+    endCall();
+    if (signalingClosing) {
+        return;
+    }
+    signalingClosing = true;
+
+    // sync_close() joins the socket's network thread; once it has, the
+    // destructor has nothing left to wait for.
+    QThreadPool::globalInstance()->start([this]() {
+        socket.sync_close();
+        QMetaObject::invokeMethod(this, [this]() {
+            signalingClosed = true;
+            qDebug() << "Signaling connection closed";
+            finishShutdown();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Client::sendHangup(const QString &peerID)
+{
+    QString hangupMessage = QString("{ \"type\": \"hangup\", \"MyId\": \"%1\", \"targetId\": \"%2\" }")
+                                .arg(id)
+                                .arg(peerID);
+
+    socket.socket()->emit("message", hangupMessage.toStdString());
+    qDebug() << "Hangup sent to peer ID:" << peerID;
+}
+
+bool Client::closePeer(const QString &peerID)
+{
+    // A peer that is already gone (both sides hung up at once, or the
+    // hangup crossed our own endCall()) gets no peerClosed(); waiting for
+    // it would leave the call Ending for good.
+    if (!webrtc->removePeer(peerID)) {
+        return false;
+    }
+    closingPeers.insert(peerID);
+    bitrateController->removePeer(peerID);
+    return true;
+}
+
+void Client::finishCall()
+{
+    // Only per-call state goes: the signaling connection, the encoder and
+    // decoder and the output device stay up for the next call. The peer
+    // connections close in the background; see onPeerClosed().
+    audioInput->stop();
+    audioOutput->reset();
+
+    const EncoderProfile profile = encoder->profile();
+    if (profile.bitrate != OPUS_AUTO) {
+        bitrateController->reset(profile.bitrate);
+    }
+
+    if (closingPeers.isEmpty()) {
+        setCallState(CallState::Idle);
+        Q_EMIT callEnded();
+    } else {
+        setCallState(CallState::Ending);
+    }
+    qDebug() << "Call ended for" << id << "," << closingPeers.size() << "peer connections still closing";
+}
+
+void Client::finishShutdown()
+{
+    if (signalingClosed && closingPeers.isEmpty()) {
+        Q_EMIT shutdownFinished();
+    }
+}
+
+void Client::setCallState(CallState state)
+{
+    if (callState == state) {
+        return;
+    }
+    callState = state;
+    Q_EMIT callStateChanged(state);
+}
+
+void Client::onPeerClosed(const QString &peerId)
+{
+    if (!closingPeers.remove(peerId) || !closingPeers.isEmpty()) {
+        return;
+    }
+
+    qDebug() << "All peer connections of the last call are closed";
+    // A new call may already be running; it is not affected.
+    if (callState == CallState::Ending) {
+        setCallState(CallState::Idle);
+        Q_EMIT callEnded();
+    }
+    finishShutdown();
+}
+
+void Client::setEncoderProfile(const EncoderProfile &profile)
+{
+    if (!encoder->setProfile(profile))
+        return;
+    audioInput->setFrameDuration(profile.frameDurationUs);
+
+    // Keep the SDP in line with the encoder, and let the controller adapt
+    // below the profile's bitrate.
+    const int bitRate = profile.bitrate != OPUS_AUTO ? profile.bitrate : webrtc->bitRate();
+    webrtc->setSdpSettings(bitRate, profile.inbandFec, profile.dtx);
+
+    if (profile.bitrate != OPUS_AUTO) {
+        bitrateController->setBitrateRange(6000, profile.bitrate);
+        bitrateController->reset(profile.bitrate);
+    }
+}
+
+void Client::onNetworkFeedback(const QString &peerId, double fractionLost, int rttMs, int receiveRate)
+{
+    // Collected per peer; the controller steps once per interval, on the
+    // worst of them (see callStatsChanged above).
+    bitrateController->addReport(peerId, fractionLost, rttMs, receiveRate);
+}
+
 void Client::onOfferIsReady (const QString &peerID, const QString& description)
 {
     qDebug() << "Offer is ready for peer:" << peerID << "\nSDP Description:\n" << description;
@@ -109,6 +285,22 @@ void Client::onAnswerIsReady(const QString &peerID, const QString& description)
     qDebug() << "SDP answer message sent for peer ID:" << peerID;
 }
 
+void Client::onLocalCandidateGenerated(const QString &peerID, const QString &candidate, const QString &sdpMid)
+{
+    // Without trickle ICE the candidates are already part of the SDP.
+    if (!webrtc->trickleIce())
+        return;
+
+    QString candidateMessage = QString("{ \"type\": \"candidate\", \"MyId\": \"%1\", \"targetId\": \"%2\", \"candidate\": \"%3\", \"sdpMid\": \"%4\" }")
+                                   .arg(id)
+                                   .arg(peerID)
+                                   .arg(candidate)
+                                   .arg(sdpMid);
+
+    socket.socket()->emit("message", candidateMessage.toStdString());
+    qDebug() << "ICE candidate sent for peer ID:" << peerID;
+}
+
 
 void Client::onMessageReceived(const std::string& message)
 {
@@ -127,6 +319,7 @@ void Client::onMessageReceived(const std::string& message)
 
     if (type == "offer") {
 
+        setCallState(CallState::Active);
         webrtc->addPeer(peerID);
         webrtc->setRemoteDescription(peerID, sdp);
         webrtc->generateAnswerSDP(peerID);
@@ -135,20 +328,17 @@ void Client::onMessageReceived(const std::string& message)
         webrtc->setRemoteDescription(peerID, sdp);
         qDebug() << "Message received on offerer:" << QString::fromStdString(message);
     }
+    else if (type == "candidate") {
+        webrtc->setRemoteCandidate(peerID, obj["candidate"].toString(), obj["sdpMid"].toString());
+    }
+    else if (type == "hangup") {
+        if (closePeer(peerID) && webrtc->peerIds().isEmpty()) {
+            finishCall();
+        }
+    }
 }
 
 void Client::onOpenedDataChannel(const QString &peerId)
 {
     audioInput->start();
 }
-
-void Client::onDataReady(QByteArray &data)
-{
-    webrtc->sendTrack(peerId_, data);
-}
-
-void Client::onIncommingPacket(const QString &peerId, const QByteArray &data, qint64 len)
-{
-    qDebug() << "packet for:" << id <<"from peer:"<< peerId;
-    audioOutput->addData(data);
-}
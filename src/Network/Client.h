@@ -6,9 +6,14 @@
 #include <QRandomGenerator>
 #include "Audio/AudioInput.h"
 #include "Audio/AudioOutput.h"
+#include "Audio/OpusEncoderStage.h"
 #include <QMutex>
+#include <QSet>
 #include "SocketIO/sio_client.h"
 #include "Network/webrtc.h"
+#include "Network/BitrateController.h"
+#include "Network/RtpSenderStage.h"
+#include "Pipeline/Pipeline.h"
 using namespace std;
 
 class Client : public QObject
@@ -22,6 +27,33 @@ public:
     void sendRegisterRequest();
     void sendSdp(const string &clientId);
     void startCall(QString peerId);
+    enum class CallState {
+        Idle,
+        Active,
+        Ending      // hung up, peer connections still closing in the background
+    };
+
+    // Hangs up on every peer without waiting for the connections to close;
+    // callEnded() follows once they have. The signaling session, audio
+    // devices and codec state are kept, so the next startCall() only builds
+    // the peer, and it may come before callEnded().
+    void endCall();
+    // endCall() plus closing the signaling connection off the GUI thread.
+    // Delete the client after shutdownFinished().
+    void shutdown();
+    CallState state() const { return callState; }
+    void setEncoderProfile(const EncoderProfile &profile);
+    EncoderProfile encoderProfile() const { return encoder->profile(); }
+    // Per-stage timing of capture -> encode -> send, keyed by stage name.
+    QVariantMap sendPipelineStats() const { return sendPipeline.timingStats(); }
+    // Audio from and to somewhere other than the sound card, e.g. for runs
+    // without audio hardware; see FileCapture, FilePlayback, NullPlayback.
+    void setCaptureEndpoint(std::unique_ptr<CaptureEndpoint> endpoint) { audioInput->setCaptureEndpoint(std::move(endpoint)); }
+    void setPlaybackEndpoint(std::unique_ptr<PlaybackEndpoint> endpoint) { audioOutput->setPlaybackEndpoint(std::move(endpoint)); }
+    QAudioFormat captureFormat() const { return audioInput->format(); }
+    QAudioFormat playbackFormat() const { return audioOutput->format(); }
+    // Takes effect for the next call; see IceSettings::hostOnlyLan() for LAN use.
+    bool setIceSettings(const IceSettings &settings) { return webrtc->setIceSettings(settings); }
     bool getIsOfferer() {return isOfferer;}
     QString getPeerId() { return peerId_; }
 
@@ -30,22 +62,47 @@ private:
 
     void onConnected();
     void onMessageReceived(const std::string& message);
+    void sendHangup(const QString &peerID);
+    bool closePeer(const QString &peerID);
+    void finishCall();
+    void finishShutdown();
+    void setCallState(CallState state);
 
 
     AudioInput* audioInput;
+    OpusEncoderStage* encoder;
+    RtpSenderStage* rtpSender;
+    Pipeline sendPipeline;
     AudioOutput* audioOutput;
     QString peerId_;
     QString id;
     bool isOfferer;
     WebRTC* webrtc;
+    BitrateController* bitrateController;
     QMutex mutex;
+    CallState callState = CallState::Idle;
+    QSet<QString> closingPeers;
+    bool signalingClosing = false;
+    bool signalingClosed = false;
+
+Q_SIGNALS:
+    // The signaling connection is up; emitted on the socket's thread.
+    void signalingConnected();
+    void callStateChanged(Client::CallState state);
+    // Every peer connection of the ended call is closed.
+    void callEnded();
+    void shutdownFinished();
+
+public Q_SLOTS:
+    // Receiver feedback for our outgoing stream; drives the encoder bitrate.
+    void onNetworkFeedback(const QString &peerId, double fractionLost, int rttMs, int receiveRate);
 
 private Q_SLOTS:
     void onOfferIsReady(const QString &peerID, const QString& description);
     void onAnswerIsReady(const QString &peerID, const QString& description);
+    void onLocalCandidateGenerated(const QString &peerID, const QString &candidate, const QString &sdpMid);
     void onOpenedDataChannel(const QString &peerId);
-    void onDataReady(QByteArray &data);
-    void onIncommingPacket(const QString &peerId, const QByteArray &data, qint64 len);
+    void onPeerClosed(const QString &peerId);
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef ICESETTINGS_H
+#define ICESETTINGS_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+/**
+ * ICE gathering policy of a call, turned into the rtc::Configuration of
+ * every peer connection that is created afterwards.
+ */
+struct IceSettings
+{
+    QStringList servers = {"stun:stun.l.google.com:19302"};    // STUN/TURN URLs, ignored when hostOnly
+    quint16 portRangeBegin = 1024;
+    quint16 portRangeEnd = 65535;
+    QString bindAddress;                        // gather on this interface only; empty for all
+    bool hostOnly = false;                      // no STUN/TURN: local interface candidates only
+    int gatheringTimeoutMs = 0;                 // signal what was gathered after this long; 0 waits for completion
+
+    static IceSettings internet() { return IceSettings(); }
+
+    // LAN and air-gapped calls: nothing to wait for but the local
+    // interfaces, so gathering finishes almost at once.
+    static IceSettings hostOnlyLan()
+    {
+        IceSettings settings;
+        settings.servers.clear();
+        settings.hostOnly = true;
+        settings.gatheringTimeoutMs = 200;
+        return settings;
+    }
+
+    bool isValid() const
+    {
+        return portRangeBegin > 0 && portRangeBegin <= portRangeEnd && gatheringTimeoutMs >= 0;
+    }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PEERCONTEXT_H
+#define PEERCONTEXT_H
+
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <utility>
+#include <rtc/rtc.hpp>
+#include "Network/RtcpSession.h"
+#include "Network/RtpStream.h"
+
+/**
+ * One peer connection with its audio track, RTP stream and RTCP session.
+ * A pooled connection is built before anyone knows which peer it will be
+ * for, so its callbacks read the peer ID from here rather than capturing
+ * it; it stays empty until a call claims the connection.
+ */
+class PeerContext
+{
+public:
+    std::shared_ptr<rtc::PeerConnection>    peerConnection;
+    RtpStreamHandle                         stream;
+    std::shared_ptr<RtcpSession>            session;
+
+    // Set by libdatachannel's onTrack on its own thread and read on the
+    // teardown and GUI threads, hence the atomic access, as in RtpStream.
+    std::shared_ptr<rtc::Track> track() const { return std::atomic_load(&m_track); }
+    void setTrack(std::shared_ptr<rtc::Track> track) { std::atomic_store(&m_track, std::move(track)); }
+
+    QString peerId() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_peerId;
+    }
+
+    void setPeerId(const QString &peerId)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_peerId = peerId;
+    }
+
+private:
+    std::shared_ptr<rtc::Track>             m_track;
+    mutable QMutex                          m_mutex;
+    QString                                 m_peerId;
+};
+
+using PeerContextHandle = std::shared_ptr<PeerContext>;
+
+#endif
@@ -0,0 +1,245 @@
+#include "RtcpPacket.h"
+#include <chrono>
+#include <cstring>
+
+static constexpr int HeaderSize = 4;
+static constexpr int ReportBlockSize = 24;
+static constexpr int SenderInfoSize = 20;
+// Seconds from the NTP epoch (1900) to the Unix epoch (1970).
+static constexpr quint64 NtpUnixOffset = 2208988800ULL;
+
+static void writeUint16(unsigned char *data, quint16 value)
+{
+    data[0] = static_cast<unsigned char>(value >> 8);
+    data[1] = static_cast<unsigned char>(value);
+}
+
+static void writeUint32(unsigned char *data, quint32 value)
+{
+    data[0] = static_cast<unsigned char>(value >> 24);
+    data[1] = static_cast<unsigned char>(value >> 16);
+    data[2] = static_cast<unsigned char>(value >> 8);
+    data[3] = static_cast<unsigned char>(value);
+}
+
+static quint16 readUint16(const unsigned char *data)
+{
+    return quint16((data[0] << 8) | data[1]);
+}
+
+static quint32 readUint32(const unsigned char *data)
+{
+    return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | quint32(data[3]);
+}
+
+static void writeHeader(unsigned char *data, int count, int packetType, int size)
+{
+    data[0] = static_cast<unsigned char>(0x80 | count);
+    data[1] = static_cast<unsigned char>(packetType);
+    writeUint16(data + 2, quint16(size / 4 - 1));
+}
+
+static void writeReportBlock(unsigned char *data, const RtcpReportBlock &block)
+{
+    // Cumulative loss is a 24 bit two's complement number.
+    const qint32 lost = qBound(-0x800000, block.cumulativeLost, 0x7fffff);
+
+    writeUint32(data, block.ssrc);
+    writeUint32(data + 4, (quint32(block.fractionLost) << 24) | (quint32(lost) & 0xffffff));
+    writeUint32(data + 8, block.extendedHighestSequence);
+    writeUint32(data + 12, block.jitter);
+    writeUint32(data + 16, block.lastSenderReport);
+    writeUint32(data + 20, block.delaySinceLastSenderReport);
+}
+
+static RtcpReportBlock readReportBlock(const unsigned char *data)
+{
+    RtcpReportBlock block;
+    block.ssrc = readUint32(data);
+    block.fractionLost = data[4];
+    const quint32 lost = readUint32(data + 4) & 0xffffff;
+    block.cumulativeLost = (lost & 0x800000) ? qint32(lost) - 0x1000000 : qint32(lost);
+    block.extendedHighestSequence = readUint32(data + 8);
+    block.jitter = readUint32(data + 12);
+    block.lastSenderReport = readUint32(data + 16);
+    block.delaySinceLastSenderReport = readUint32(data + 20);
+    return block;
+}
+
+/**
+ * ====================================================
+ * ==================== RtcpPacket ====================
+ * ====================================================
+ */
+
+int RtcpPacket::writeSenderReport(unsigned char *data, int capacity, quint32 ssrc, const RtcpSenderInfo &info,
+                                  const RtcpReportBlock *blocks, int blockCount)
+{
+    const int size = HeaderSize + 4 + SenderInfoSize + ReportBlockSize * blockCount;
+    if (blockCount < 0 || blockCount > RtcpReport::MaxBlocks || size > capacity)
+        return 0;
+
+    writeHeader(data, blockCount, SenderReport, size);
+    writeUint32(data + 4, ssrc);
+    writeUint32(data + 8, quint32(info.ntpTimestamp >> 32));
+    writeUint32(data + 12, quint32(info.ntpTimestamp));
+    writeUint32(data + 16, info.rtpTimestamp);
+    writeUint32(data + 20, info.packetCount);
+    writeUint32(data + 24, info.octetCount);
+    for (int i = 0; i < blockCount; ++i)
+        writeReportBlock(data + 28 + ReportBlockSize * i, blocks[i]);
+
+    return size;
+}
+
+int RtcpPacket::writeReceiverReport(unsigned char *data, int capacity, quint32 ssrc,
+                                    const RtcpReportBlock *blocks, int blockCount)
+{
+    const int size = HeaderSize + 4 + ReportBlockSize * blockCount;
+    if (blockCount < 0 || blockCount > RtcpReport::MaxBlocks || size > capacity)
+        return 0;
+
+    writeHeader(data, blockCount, ReceiverReport, size);
+    writeUint32(data + 4, ssrc);
+    for (int i = 0; i < blockCount; ++i)
+        writeReportBlock(data + 8 + ReportBlockSize * i, blocks[i]);
+
+    return size;
+}
+
+int RtcpPacket::writeSourceDescription(unsigned char *data, int capacity, quint32 ssrc, const char *cname, int cnameSize)
+{
+    if (cnameSize < 0 || cnameSize > 255)
+        return 0;
+
+    // One chunk: SSRC, the CNAME item, then at least one null octet that
+    // ends the item list and pads the chunk to a 32-bit boundary.
+    const int chunkSize = 4 + 2 + cnameSize;
+    const int size = HeaderSize + (chunkSize + 4) / 4 * 4;
+    if (size > capacity)
+        return 0;
+
+    std::memset(data, 0, size);
+    writeHeader(data, 1, SourceDescription, size);
+    writeUint32(data + 4, ssrc);
+    data[8] = 1;   // CNAME
+    data[9] = static_cast<unsigned char>(cnameSize);
+    std::memcpy(data + 10, cname, cnameSize);
+
+    return size;
+}
+
+int RtcpPacket::writeNack(unsigned char *data, int capacity, quint32 senderSsrc, quint32 mediaSsrc,
+                          const quint16 *lost, int lostCount)
+{
+    if (lostCount <= 0 || capacity < HeaderSize + 12)
+        return 0;
+
+    int size = HeaderSize + 8;
+    for (int i = 0; i < lostCount && size + 4 <= capacity;) {
+        const quint16 packetId = lost[i++];
+        quint16 bitmask = 0;
+        while (i < lostCount) {
+            const quint16 distance = quint16(lost[i] - packetId);
+            if (distance == 0 || distance > 16)
+                break;
+            bitmask |= quint16(1u << (distance - 1));
+            ++i;
+        }
+        writeUint16(data + size, packetId);
+        writeUint16(data + size + 2, bitmask);
+        size += 4;
+    }
+
+    writeHeader(data, NackFormat, TransportFeedback, size);
+    writeUint32(data + 4, senderSsrc);
+    writeUint32(data + 8, mediaSsrc);
+    return size;
+}
+
+quint64 RtcpPacket::ntpNow()
+{
+    using namespace std::chrono;
+    const qint64 us = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    const quint64 seconds = quint64(us / 1000000) + NtpUnixOffset;
+    const quint64 fraction = (quint64(us % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+/**
+ * ====================================================
+ * ==================== RtcpReader ====================
+ * ====================================================
+ */
+
+bool RtcpReader::next()
+{
+    if (m_offset + HeaderSize > m_size)
+        return false;
+
+    const unsigned char *packet = m_data + m_offset;
+    const int size = 4 * (readUint16(packet + 2) + 1);
+    if ((packet[0] >> 6) != 2 || m_offset + size > m_size)
+        return false;
+
+    int padding = 0;
+    if (packet[0] & 0x20) {
+        padding = packet[size - 1];
+        if (padding > size - HeaderSize)
+            return false;
+    }
+
+    m_count = packet[0] & 0x1f;
+    m_packetType = packet[1];
+    m_body = packet + HeaderSize;
+    m_bodySize = size - HeaderSize - padding;
+    m_offset += size;
+    return true;
+}
+
+bool RtcpReader::readReport(RtcpReport *report) const
+{
+    const bool isSenderReport = m_packetType == RtcpPacket::SenderReport;
+    if (!isSenderReport && m_packetType != RtcpPacket::ReceiverReport)
+        return false;
+
+    const int blocksOffset = 4 + (isSenderReport ? SenderInfoSize : 0);
+    if (m_bodySize < blocksOffset + ReportBlockSize * m_count)
+        return false;
+
+    report->senderSsrc = readUint32(m_body);
+    report->hasSenderInfo = isSenderReport;
+    if (isSenderReport) {
+        report->senderInfo.ntpTimestamp = (quint64(readUint32(m_body + 4)) << 32) | readUint32(m_body + 8);
+        report->senderInfo.rtpTimestamp = readUint32(m_body + 12);
+        report->senderInfo.packetCount = readUint32(m_body + 16);
+        report->senderInfo.octetCount = readUint32(m_body + 20);
+    }
+
+    report->blockCount = m_count;
+    for (int i = 0; i < m_count; ++i)
+        report->blocks[i] = readReportBlock(m_body + blocksOffset + ReportBlockSize * i);
+
+    return true;
+}
+
+int RtcpReader::readNack(quint32 *mediaSsrc, quint16 *lost, int maxLost) const
+{
+    if (m_packetType != RtcpPacket::TransportFeedback || m_count != RtcpPacket::NackFormat || m_bodySize < 8)
+        return 0;
+
+    *mediaSsrc = readUint32(m_body + 4);
+
+    int lostCount = 0;
+    for (int offset = 8; offset + 4 <= m_bodySize; offset += 4) {
+        const quint16 packetId = readUint16(m_body + offset);
+        const quint16 bitmask = readUint16(m_body + offset + 2);
+        if (lostCount < maxLost)
+            lost[lostCount++] = packetId;
+        for (int bit = 0; bit < 16 && lostCount < maxLost; ++bit) {
+            if (bitmask & (1u << bit))
+                lost[lostCount++] = quint16(packetId + bit + 1);
+        }
+    }
+    return lostCount;
+}
@@ -0,0 +1,109 @@
+#ifndef RTCPPACKET_H
+#define RTCPPACKET_H
+
+#include <QtGlobal>
+
+/**
+ * RTCP sender and receiver reports and SDES (RFC 3550 6.4, 6.5) and generic
+ * NACKs (RFC 4585 6.2.1), written and read with explicit byte shifts like
+ * the RTP header in RtpPacket.h.
+ */
+
+struct RtcpReportBlock
+{
+    quint32 ssrc = 0;                       // source this block reports on
+    quint8 fractionLost = 0;                // fixed point, lost / expected * 256
+    qint32 cumulativeLost = 0;              // 24 bit signed on the wire
+    quint32 extendedHighestSequence = 0;
+    quint32 jitter = 0;                     // RTP timestamp units
+    quint32 lastSenderReport = 0;           // middle 32 bits of the last SR's NTP time
+    quint32 delaySinceLastSenderReport = 0; // 1/65536 s
+};
+
+struct RtcpSenderInfo
+{
+    quint64 ntpTimestamp = 0;
+    quint32 rtpTimestamp = 0;
+    quint32 packetCount = 0;
+    quint32 octetCount = 0;
+};
+
+// A parsed SR or RR.
+struct RtcpReport
+{
+    static constexpr int MaxBlocks = 31;
+
+    quint32 senderSsrc = 0;
+    bool hasSenderInfo = false;
+    RtcpSenderInfo senderInfo;
+    int blockCount = 0;
+    RtcpReportBlock blocks[MaxBlocks];
+};
+
+class RtcpPacket
+{
+public:
+    static constexpr int SenderReport = 200;
+    static constexpr int ReceiverReport = 201;
+    static constexpr int SourceDescription = 202;
+    static constexpr int Goodbye = 203;
+    static constexpr int Application = 204;
+    static constexpr int TransportFeedback = 205;
+    static constexpr int NackFormat = 1;
+
+    // Each writer returns the number of bytes written, or 0 if they do not
+    // fit into capacity. Packets can be written back to back into one
+    // compound packet, which must start with an SR or RR.
+    static int writeSenderReport(unsigned char *data, int capacity, quint32 ssrc, const RtcpSenderInfo &info,
+                                 const RtcpReportBlock *blocks, int blockCount);
+    static int writeReceiverReport(unsigned char *data, int capacity, quint32 ssrc,
+                                   const RtcpReportBlock *blocks, int blockCount);
+    static int writeSourceDescription(unsigned char *data, int capacity, quint32 ssrc, const char *cname, int cnameSize);
+    // lost holds the missing sequence numbers in ascending order; runs of up
+    // to 17 share one PID + BLP entry.
+    static int writeNack(unsigned char *data, int capacity, quint32 senderSsrc, quint32 mediaSsrc,
+                         const quint16 *lost, int lostCount);
+
+    // Wall clock as a 64-bit NTP timestamp, and its middle 32 bits as used
+    // by LSR and DLSR.
+    static quint64 ntpNow();
+    static quint32 compactNtp(quint64 ntpTimestamp) { return quint32(ntpTimestamp >> 16); }
+};
+
+/**
+ * Walks the packets of a compound RTCP packet. Stops at the first packet
+ * whose length does not fit, so a malformed tail is ignored rather than
+ * misread.
+ */
+class RtcpReader
+{
+public:
+    RtcpReader(const unsigned char *data, int size) : m_data(data), m_size(size) {}
+
+    // Moves to the next packet; false at the end.
+    bool next();
+
+    int packetType() const { return m_packetType; }
+    // RC for reports, SC for SDES, FMT for feedback messages.
+    int count() const { return m_count; }
+    // Everything behind the 4 byte common header, padding excluded.
+    const unsigned char *body() const { return m_body; }
+    int bodySize() const { return m_bodySize; }
+
+    // Valid for SenderReport and ReceiverReport packets.
+    bool readReport(RtcpReport *report) const;
+    // Valid for generic NACKs. Stores up to maxLost requested sequence
+    // numbers and returns how many there are.
+    int readNack(quint32 *mediaSsrc, quint16 *lost, int maxLost) const;
+
+private:
+    const unsigned char    *m_data;
+    int                     m_size;
+    int                     m_offset = 0;
+    int                     m_packetType = 0;
+    int                     m_count = 0;
+    const unsigned char    *m_body = nullptr;
+    int                     m_bodySize = 0;
+};
+
+#endif
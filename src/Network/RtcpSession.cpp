@@ -0,0 +1,279 @@
+#include "RtcpSession.h"
+#include <algorithm>
+#include <cstdlib>
+
+RtcpSession::RtcpSession(RtpStreamHandle stream, const std::string &cname)
+    : m_stream(std::move(stream)),
+    m_cname(cname.substr(0, 255))
+{
+}
+
+quint32 RtcpSession::onRtpPacket(const RtpPacket &packet)
+{
+    const qint64 nowUs = RtpStream::clockUs();
+    QMutexLocker locker(&m_mutex);
+
+    // A new SSRC is a new source: start its statistics over (RFC 3550 A.1).
+    quint32 extendedSequence;
+    if (!m_receiving || packet.header.ssrc != m_remoteSsrc) {
+        m_receiving = true;
+        m_remoteSsrc = packet.header.ssrc;
+        m_unwrapper.reset();
+        extendedSequence = m_unwrapper.unwrap(packet.header.sequenceNumber);
+        m_baseSequence = extendedSequence;
+        m_expectedPrior = 0;
+        m_receivedPrior = 0;
+        m_hasTransit = false;
+        m_jitter = 0.0;
+        m_lastSenderReport = 0;
+        m_stats.packetsReceived = 0;
+        m_stats.bytesReceived = 0;
+        m_pendingNackCount = 0;
+    } else {
+        const quint32 previousHighest = m_unwrapper.highest();
+        extendedSequence = m_unwrapper.unwrap(packet.header.sequenceNumber);
+        if (extendedSequence > previousHighest + 1)
+            addPendingNacks(previousHighest + 1, extendedSequence - 1, nowUs);
+        else if (extendedSequence <= previousHighest && removePendingNack(extendedSequence))
+            ++m_stats.packetsRecovered;
+    }
+
+    ++m_stats.packetsReceived;
+    m_stats.bytesReceived += quint64(packet.payloadSize);
+
+    // Interarrival jitter (RFC 3550 A.8), both sides on the RTP clock.
+    const quint32 arrival = quint32(nowUs * ClockRate / 1000000);
+    const quint32 transit = arrival - packet.header.timestamp;
+    if (m_hasTransit) {
+        const double d = std::abs(double(qint32(transit - m_lastTransit)));
+        m_jitter += (d - m_jitter) / 16.0;
+    }
+    m_hasTransit = true;
+    m_lastTransit = transit;
+    m_stats.jitterMs = m_jitter * 1000.0 / ClockRate;
+
+    return extendedSequence;
+}
+
+bool RtcpSession::onRtcpPacket(const unsigned char *data, int size)
+{
+    const qint64 nowUs = RtpStream::clockUs();
+    const quint32 compactNow = RtcpPacket::compactNtp(RtcpPacket::ntpNow());
+    const quint32 ownSsrc = m_stream->ssrc();
+    bool feedback = false;
+
+    // NACKed packets are sent again once the lock is released, so
+    // onRtpPacket() and the reports never wait for libdatachannel.
+    quint16 retransmissions[MaxPendingNacks];
+    int retransmissionCount = 0;
+
+    QMutexLocker locker(&m_mutex);
+    RtcpReader reader(data, size);
+    RtcpReport report;
+    while (reader.next()) {
+        if (reader.packetType() == RtcpPacket::TransportFeedback) {
+            quint32 mediaSsrc = 0;
+            const int lostCount = reader.readNack(&mediaSsrc, retransmissions + retransmissionCount,
+                                                  MaxPendingNacks - retransmissionCount);
+            if (mediaSsrc != ownSsrc)
+                continue;
+            m_stats.nacksReceived += quint64(lostCount);
+            retransmissionCount += lostCount;
+            continue;
+        }
+
+        if (!reader.readReport(&report))
+            continue;
+
+        if (report.hasSenderInfo) {
+            m_lastSenderReport = RtcpPacket::compactNtp(report.senderInfo.ntpTimestamp);
+            m_lastSenderReportUs = nowUs;
+        }
+
+        for (int i = 0; i < report.blockCount; ++i) {
+            const RtcpReportBlock &block = report.blocks[i];
+            if (block.ssrc != ownSsrc)
+                continue;
+
+            m_stats.fractionLost = block.fractionLost / 256.0;
+            m_stats.packetsLost = block.cumulativeLost;
+            m_stats.remoteJitterMs = block.jitter * 1000.0 / ClockRate;
+
+            // RTT = now - LSR - DLSR, all in 1/65536 s (RFC 3550 6.4.1).
+            if (block.lastSenderReport != 0) {
+                const quint32 rtt = compactNow - block.lastSenderReport - block.delaySinceLastSenderReport;
+                if (rtt < 60u * 65536u)
+                    m_stats.rttMs = int(quint64(rtt) * 1000 / 65536);
+            }
+
+            // What arrives is what we sent since the last report minus the loss.
+            const quint64 octets = m_stream->octetsSent();
+            if (m_reportedUs != 0 && nowUs > m_reportedUs) {
+                const double sentRate = double(octets - m_reportedOctets) * 8.0 * 1000000.0 / double(nowUs - m_reportedUs);
+                m_stats.remoteReceiveRate = int(sentRate * (1.0 - m_stats.fractionLost));
+            }
+            m_reportedOctets = octets;
+            m_reportedUs = nowUs;
+
+            feedback = true;
+        }
+    }
+    locker.unlock();
+
+    for (int i = 0; i < retransmissionCount; ++i)
+        m_stream->retransmit(retransmissions[i]);
+
+    return feedback;
+}
+
+int RtcpSession::writeReport(unsigned char *data, int capacity)
+{
+    const qint64 nowUs = RtpStream::clockUs();
+    QMutexLocker locker(&m_mutex);
+
+    RtcpReportBlock block;
+    const int blockCount = m_receiving ? 1 : 0;
+    if (m_receiving)
+        block = receiveReportBlock(nowUs);
+
+    const quint32 ssrc = m_stream->ssrc();
+    int size;
+    if (m_stream->packetsSent() > 0) {
+        // Extrapolate the RTP timestamp of the last packet to the NTP time.
+        RtcpSenderInfo info;
+        info.ntpTimestamp = RtcpPacket::ntpNow();
+        info.rtpTimestamp = m_stream->lastTimestamp()
+                            + quint32((nowUs - m_stream->lastSendUs()) * ClockRate / 1000000);
+        info.packetCount = quint32(m_stream->packetsSent());
+        info.octetCount = quint32(m_stream->octetsSent());
+        size = RtcpPacket::writeSenderReport(data, capacity, ssrc, info, &block, blockCount);
+    } else {
+        size = RtcpPacket::writeReceiverReport(data, capacity, ssrc, &block, blockCount);
+    }
+    if (size == 0)
+        return 0;
+
+    // Every compound packet carries a CNAME (RFC 3550 6.1).
+    const int sdesSize = RtcpPacket::writeSourceDescription(data + size, capacity - size, ssrc,
+                                                            m_cname.data(), int(m_cname.size()));
+    return sdesSize == 0 ? 0 : size + sdesSize;
+}
+
+int RtcpSession::writeNack(unsigned char *data, int capacity)
+{
+    const qint64 nowUs = RtpStream::clockUs();
+    QMutexLocker locker(&m_mutex);
+    if (m_pendingNackCount == 0)
+        return 0;
+
+    const qint64 playoutDelayUs = qint64(m_playoutDelayMs.load(std::memory_order_relaxed)) * 1000;
+    // Ask again once the previous request had time for a round trip.
+    const qint64 retryUs = m_stats.rttMs >= 0 ? std::max<qint64>(20000, qint64(m_stats.rttMs) * 1500) : 100000;
+
+    quint16 lost[MaxPendingNacks];
+    int lostCount = 0;
+    int kept = 0;
+    for (int i = 0; i < m_pendingNackCount; ++i) {
+        PendingNack &nack = m_pendingNacks[i];
+        if (nack.requests >= MaxNackRequests || nowUs - nack.missingSinceUs > playoutDelayUs)
+            continue;
+
+        if (nack.requests == 0 || nowUs - nack.lastRequestUs >= retryUs) {
+            ++nack.requests;
+            nack.lastRequestUs = nowUs;
+            lost[lostCount++] = quint16(nack.sequence);
+        }
+        m_pendingNacks[kept++] = nack;
+    }
+    m_pendingNackCount = kept;
+    if (lostCount == 0)
+        return 0;
+
+    // Feedback still goes out as a compound packet that starts with a report.
+    const quint32 ssrc = m_stream->ssrc();
+    const int size = RtcpPacket::writeReceiverReport(data, capacity, ssrc, nullptr, 0);
+    if (size == 0)
+        return 0;
+    const int nackSize = RtcpPacket::writeNack(data + size, capacity - size, ssrc, m_remoteSsrc, lost, lostCount);
+    if (nackSize == 0)
+        return 0;
+
+    m_stats.nacksSent += quint64(lostCount);
+    return size + nackSize;
+}
+
+PeerRtpStats RtcpSession::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    PeerRtpStats stats = m_stats;
+    stats.packetsSent = m_stream->packetsSent();
+    stats.bytesSent = m_stream->octetsSent();
+    stats.packetsRetransmitted = m_stream->packetsRetransmitted();
+    return stats;
+}
+
+RtcpReportBlock RtcpSession::receiveReportBlock(qint64 nowUs)
+{
+    // Loss since the previous report and overall (RFC 3550 A.3).
+    const quint64 expected = quint64(m_unwrapper.highest()) - m_baseSequence + 1;
+    const quint64 received = m_stats.packetsReceived;
+    const qint64 expectedInterval = qint64(expected - m_expectedPrior);
+    const qint64 receivedInterval = qint64(received - m_receivedPrior);
+    const qint64 lostInterval = expectedInterval - receivedInterval;
+    m_expectedPrior = expected;
+    m_receivedPrior = received;
+
+    RtcpReportBlock block;
+    block.ssrc = m_remoteSsrc;
+    block.fractionLost = (expectedInterval <= 0 || lostInterval <= 0)
+                             ? 0 : quint8(std::min<qint64>(255, (lostInterval << 8) / expectedInterval));
+    block.cumulativeLost = qint32(qint64(expected) - qint64(received));
+    block.extendedHighestSequence = m_unwrapper.highest();
+    block.jitter = quint32(m_jitter);
+    block.lastSenderReport = m_lastSenderReport;
+    if (m_lastSenderReport != 0)
+        block.delaySinceLastSenderReport = quint32((nowUs - m_lastSenderReportUs) * 65536 / 1000000);
+
+    m_stats.receiveFractionLost = block.fractionLost / 256.0;
+    m_stats.receivePacketsLost = block.cumulativeLost;
+    return block;
+}
+
+void RtcpSession::addPendingNacks(quint32 first, quint32 last, qint64 nowUs)
+{
+    // A resend takes a round trip; once that is longer than the playout
+    // delay the packet would arrive too late to be played.
+    const int playoutDelayMs = m_playoutDelayMs.load(std::memory_order_relaxed);
+    if (m_stats.rttMs >= playoutDelayMs)
+        return;
+
+    // A gap wider than the list is a burst we cannot recover; only the
+    // newest sequence numbers are still worth asking for.
+    if (last - first >= quint32(MaxPendingNacks))
+        first = last - MaxPendingNacks + 1;
+
+    for (quint32 sequence = first; sequence <= last; ++sequence) {
+        if (m_pendingNackCount == MaxPendingNacks) {
+            std::copy(m_pendingNacks.begin() + 1, m_pendingNacks.end(), m_pendingNacks.begin());
+            --m_pendingNackCount;
+        }
+        PendingNack &nack = m_pendingNacks[m_pendingNackCount++];
+        nack.sequence = sequence;
+        nack.missingSinceUs = nowUs;
+        nack.lastRequestUs = 0;
+        nack.requests = 0;
+    }
+}
+
+bool RtcpSession::removePendingNack(quint32 sequence)
+{
+    for (int i = 0; i < m_pendingNackCount; ++i) {
+        if (m_pendingNacks[i].sequence == sequence) {
+            std::copy(m_pendingNacks.begin() + i + 1, m_pendingNacks.begin() + m_pendingNackCount,
+                      m_pendingNacks.begin() + i);
+            --m_pendingNackCount;
+            return true;
+        }
+    }
+    return false;
+}
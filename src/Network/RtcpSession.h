@@ -0,0 +1,120 @@
+#ifndef RTCPSESSION_H
+#define RTCPSESSION_H
+
+#include <QMutex>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <string>
+#include "Network/RtcpPacket.h"
+#include "Network/RtpPacket.h"
+#include "Network/RtpStream.h"
+
+// Call quality of one peer, in both directions.
+struct PeerRtpStats
+{
+    quint64 packetsSent = 0;
+    quint64 bytesSent = 0;                  // payload octets
+    quint64 packetsReceived = 0;
+    quint64 bytesReceived = 0;              // payload octets
+
+    // Our stream, as last reported by the peer.
+    double fractionLost = 0.0;              // 0.0 - 1.0 over the peer's last report interval
+    qint64 packetsLost = 0;
+    double remoteJitterMs = 0.0;
+    int rttMs = -1;                         // -1 until the peer has echoed one of our SRs
+    int remoteReceiveRate = 0;              // bits per second of our stream that arrive, estimated
+
+    // The peer's stream, as measured here.
+    double receiveFractionLost = 0.0;       // over our last report interval
+    qint64 receivePacketsLost = 0;
+    double jitterMs = 0.0;                  // RFC 3550 interarrival jitter
+
+    // NACK based retransmission, both directions.
+    quint64 nacksReceived = 0;              // sequence numbers the peer asked for
+    quint64 packetsRetransmitted = 0;
+    quint64 nacksSent = 0;                  // sequence numbers we asked for
+    quint64 packetsRecovered = 0;           // asked for and then arrived
+};
+
+/**
+ * RTCP for one peer: receive statistics of the peer's stream (RFC 3550
+ * A.1, A.3, A.8), SR/RR + SDES generation for the periodic report, and the
+ * peer's report blocks on our stream, which give loss, jitter and the
+ * round-trip time. Gaps in the peer's stream are NACKed (RFC 4585) while
+ * a resent packet can still make it to playout, and NACKs from the peer
+ * are answered from the stream's retransmission cache. RTP and RTCP arrive
+ * on the network thread while reports are written from the timer, so
+ * everything is behind one mutex.
+ */
+class RtcpSession
+{
+public:
+    static constexpr int ClockRate = 48000;
+    static constexpr int MaxReportSize = 256;
+    static constexpr int MaxPendingNacks = 64;
+    static constexpr int MaxNackRequests = 3;
+    static constexpr int DefaultPlayoutDelayMs = 60;
+
+    RtcpSession(RtpStreamHandle stream, const std::string &cname);
+
+    // Returns the packet's sequence number extended to 32 bits.
+    quint32 onRtpPacket(const RtpPacket &packet);
+    // True when the compound packet carried a report on our stream, i.e.
+    // stats() has fresh sender-side feedback. Answers NACKs by resending
+    // from the stream's cache, outside the session's lock.
+    bool onRtcpPacket(const unsigned char *data, int size);
+
+    // SR while we are sending, RR otherwise, followed by SDES. Returns the
+    // compound packet size, or 0 if capacity is too small.
+    int writeReport(unsigned char *data, int capacity);
+    // RR + NACK for the missing packets that are due for a (re)request.
+    // Returns 0 when there is nothing to ask for.
+    int writeNack(unsigned char *data, int capacity);
+
+    // How long the jitter buffer holds audio back. A packet that cannot be
+    // back within this time is not worth asking for.
+    void setPlayoutDelayMs(int delayMs) { m_playoutDelayMs.store(delayMs, std::memory_order_relaxed); }
+
+    PeerRtpStats stats() const;
+    RtpStreamHandle stream() const { return m_stream; }
+
+private:
+    struct PendingNack {
+        quint32 sequence = 0;               // extended
+        qint64 missingSinceUs = 0;
+        qint64 lastRequestUs = 0;
+        int requests = 0;
+    };
+
+    RtcpReportBlock receiveReportBlock(qint64 nowUs);
+    void addPendingNacks(quint32 first, quint32 last, qint64 nowUs);
+    bool removePendingNack(quint32 sequence);
+
+    mutable QMutex      m_mutex;
+    RtpStreamHandle     m_stream;
+    std::string         m_cname;
+    PeerRtpStats        m_stats;
+
+    // Receive side
+    bool                m_receiving = false;
+    quint32             m_remoteSsrc = 0;
+    SequenceUnwrapper   m_unwrapper;
+    quint32             m_baseSequence = 0;
+    quint64             m_expectedPrior = 0;
+    quint64             m_receivedPrior = 0;
+    bool                m_hasTransit = false;
+    quint32             m_lastTransit = 0;
+    double              m_jitter = 0.0;         // RTP timestamp units
+    quint32             m_lastSenderReport = 0;
+    qint64              m_lastSenderReportUs = 0;
+    std::array<PendingNack, MaxPendingNacks> m_pendingNacks;
+    int                 m_pendingNackCount = 0;
+    std::atomic<int>    m_playoutDelayMs{DefaultPlayoutDelayMs};
+
+    // Send side, for the receive rate estimate
+    quint64             m_reportedOctets = 0;
+    qint64              m_reportedUs = 0;
+};
+
+#endif
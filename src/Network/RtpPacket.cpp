@@ -0,0 +1,169 @@
+#include "RtpPacket.h"
+#include <cstring>
+
+static void writeUint16(unsigned char *data, quint16 value)
+{
+    data[0] = static_cast<unsigned char>(value >> 8);
+    data[1] = static_cast<unsigned char>(value);
+}
+
+static void writeUint32(unsigned char *data, quint32 value)
+{
+    data[0] = static_cast<unsigned char>(value >> 24);
+    data[1] = static_cast<unsigned char>(value >> 16);
+    data[2] = static_cast<unsigned char>(value >> 8);
+    data[3] = static_cast<unsigned char>(value);
+}
+
+static quint16 readUint16(const unsigned char *data)
+{
+    return quint16((data[0] << 8) | data[1]);
+}
+
+static quint32 readUint32(const unsigned char *data)
+{
+    return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | quint32(data[3]);
+}
+
+/**
+ * ====================================================
+ * ==================== RtpHeader =====================
+ * ====================================================
+ */
+
+int RtpHeader::size() const
+{
+    return FixedSize + 4 * csrcCount + (hasExtension ? 4 + extensionSize : 0);
+}
+
+int RtpHeader::write(unsigned char *data, int capacity) const
+{
+    if (csrcCount < 0 || csrcCount > MaxCsrcCount || payloadType > 127)
+        return 0;
+    if (hasExtension && (extensionSize < 0 || extensionSize % 4 != 0 || extensionSize / 4 > 0xffff))
+        return 0;
+
+    const int headerSize = size();
+    if (headerSize > capacity)
+        return 0;
+
+    data[0] = static_cast<unsigned char>(0x80 | (hasExtension ? 0x10 : 0) | csrcCount);
+    data[1] = static_cast<unsigned char>((marker ? 0x80 : 0) | payloadType);
+    writeUint16(data + 2, sequenceNumber);
+    writeUint32(data + 4, timestamp);
+    writeUint32(data + 8, ssrc);
+
+    int offset = FixedSize;
+    for (int i = 0; i < csrcCount; ++i, offset += 4)
+        writeUint32(data + offset, csrcs[i]);
+
+    if (hasExtension) {
+        writeUint16(data + offset, extensionProfile);
+        writeUint16(data + offset + 2, quint16(extensionSize / 4));
+        if (extensionSize > 0)
+            std::memcpy(data + offset + 4, extensionData, extensionSize);
+    }
+
+    return headerSize;
+}
+
+/**
+ * ====================================================
+ * ==================== RtpPacket =====================
+ * ====================================================
+ */
+
+bool RtpPacket::parse(const unsigned char *data, int size)
+{
+    if (!data || size < RtpHeader::FixedSize || (data[0] >> 6) != 2)
+        return false;
+
+    const bool hasPadding = data[0] & 0x20;
+    header.hasExtension = data[0] & 0x10;
+    header.csrcCount = data[0] & 0x0f;
+    header.marker = data[1] & 0x80;
+    header.payloadType = data[1] & 0x7f;
+    header.sequenceNumber = readUint16(data + 2);
+    header.timestamp = readUint32(data + 4);
+    header.ssrc = readUint32(data + 8);
+
+    int offset = RtpHeader::FixedSize;
+    if (offset + 4 * header.csrcCount > size)
+        return false;
+    for (int i = 0; i < header.csrcCount; ++i, offset += 4)
+        header.csrcs[i] = readUint32(data + offset);
+
+    header.extensionProfile = 0;
+    header.extensionData = nullptr;
+    header.extensionSize = 0;
+    if (header.hasExtension) {
+        if (offset + 4 > size)
+            return false;
+        header.extensionProfile = readUint16(data + offset);
+        header.extensionSize = 4 * readUint16(data + offset + 2);
+        offset += 4;
+        if (offset + header.extensionSize > size)
+            return false;
+        header.extensionData = data + offset;
+        offset += header.extensionSize;
+    }
+
+    // The last padding octet counts the padding, itself included.
+    paddingSize = 0;
+    if (hasPadding) {
+        paddingSize = data[size - 1];
+        if (paddingSize == 0 || offset + paddingSize > size)
+            return false;
+    }
+
+    payload = data + offset;
+    payloadSize = size - offset - paddingSize;
+    return true;
+}
+
+bool RtpPacket::isRtcp(const unsigned char *data, int size)
+{
+    return size >= 4 && (data[0] >> 6) == 2 && data[1] >= 192 && data[1] <= 223;
+}
+
+/**
+ * ====================================================
+ * ================ SequenceUnwrapper =================
+ * ====================================================
+ */
+
+quint32 SequenceUnwrapper::unwrap(quint16 sequenceNumber)
+{
+    if (!m_started) {
+        m_started = true;
+        m_highest = sequenceNumber;
+        return m_highest;
+    }
+
+    const qint16 delta = qint16(quint16(sequenceNumber - quint16(m_highest)));
+    const qint64 extended = qint64(m_highest) + delta;
+    // Reordered packets from before the first one stay in cycle zero.
+    if (extended < 0)
+        return sequenceNumber;
+
+    if (delta > 0)
+        m_highest = quint32(extended);
+    return quint32(extended);
+}
+
+/**
+ * ====================================================
+ * ================= RtpTimestamper ===================
+ * ====================================================
+ */
+
+quint32 RtpTimestamper::timestamp(quint64 samplePosition, int frameSamples, bool *marker)
+{
+    if (marker)
+        *marker = !m_started || samplePosition != m_nextPosition;
+
+    m_started = true;
+    m_nextPosition = samplePosition + quint64(frameSamples);
+    // RTP timestamps wrap modulo 2^32 by design.
+    return m_base + quint32(samplePosition);
+}
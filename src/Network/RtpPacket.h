@@ -0,0 +1,106 @@
+#ifndef RTPPACKET_H
+#define RTPPACKET_H
+
+#include <QtGlobal>
+
+/**
+ * RTP header as defined in RFC 3550 5.1, with the CSRC list and the header
+ * extension of 5.3.1. Serialization uses explicit byte shifts, so the wire
+ * layout depends neither on bitfield ordering nor on host endianness.
+ */
+struct RtpHeader
+{
+    static constexpr int FixedSize = 12;
+    static constexpr int MaxCsrcCount = 15;
+
+    bool marker = false;
+    quint8 payloadType = 0;
+    quint16 sequenceNumber = 0;
+    quint32 timestamp = 0;
+    quint32 ssrc = 0;
+    int csrcCount = 0;
+    quint32 csrcs[MaxCsrcCount] = {};
+
+    // Extension body, a multiple of 4 bytes. When parsing it points into the
+    // parsed packet, when writing it is copied from the caller's buffer.
+    bool hasExtension = false;
+    quint16 extensionProfile = 0;
+    const unsigned char *extensionData = nullptr;
+    int extensionSize = 0;
+
+    int size() const;
+
+    // Returns the number of bytes written, or 0 if the header does not fit
+    // into capacity bytes or is malformed.
+    int write(unsigned char *data, int capacity) const;
+};
+
+/**
+ * Non-owning view of a received RTP packet. After a successful parse() the
+ * payload and the header extension point into the parsed buffer, which
+ * must outlive the view.
+ */
+struct RtpPacket
+{
+    // Largest packet sent; keeps SRTP + UDP/IP overhead under a 1280 byte
+    // path MTU.
+    static constexpr int MaxSize = 1200;
+    static constexpr int MaxPayloadSize = MaxSize - RtpHeader::FixedSize;
+
+    RtpHeader header;
+    const unsigned char *payload = nullptr;
+    int payloadSize = 0;
+    int paddingSize = 0;
+
+    // False for anything that is not a well-formed RTP version 2 packet.
+    bool parse(const unsigned char *data, int size);
+
+    // RTCP shares the transport with RTP when muxed (RFC 5761 4): its packet
+    // types 192-223 (SR, RR, SDES, BYE, APP, feedback) fill the byte that
+    // holds the marker bit and the RTP payload type.
+    static bool isRtcp(const unsigned char *data, int size);
+};
+
+/**
+ * Extends 16-bit RTP sequence numbers to 32 bits by counting wrap-arounds.
+ * A jump of less than half the sequence space backwards is taken as a late
+ * packet, not as a wrap.
+ */
+class SequenceUnwrapper
+{
+public:
+    quint32 unwrap(quint16 sequenceNumber);
+    quint32 highest() const { return m_highest; }
+    void reset() { m_started = false; m_highest = 0; }
+
+private:
+    bool    m_started = false;
+    quint32 m_highest = 0;
+};
+
+/**
+ * Sender side RTP timestamps on the sample clock. The encoder reports the
+ * capture position of every frame it sends, so frames it skips (DTX,
+ * dropped capture) still advance the timestamp, and the first packet after
+ * such a gap is marked as the start of a talkspurt (RFC 3551 4.1).
+ */
+class RtpTimestamper
+{
+public:
+    explicit RtpTimestamper(quint32 base = 0) : m_base(base) {}
+
+    // samplePosition: first sample of the frame, counted in clock-rate
+    // units since capture started.
+    quint32 timestamp(quint64 samplePosition, int frameSamples, bool *marker);
+
+    // Where the frame following the last one starts.
+    quint64 nextPosition() const { return m_nextPosition; }
+    void reset(quint32 base) { m_base = base; m_started = false; m_nextPosition = 0; }
+
+private:
+    quint32 m_base;
+    bool    m_started = false;
+    quint64 m_nextPosition = 0;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#include "RtpRetransmissionCache.h"
+#include <cstring>
+
+void RtpRetransmissionCache::store(quint16 sequenceNumber, const std::byte *packet, int size)
+{
+    if (size <= 0 || size > RtpPacket::MaxSize) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    Slot &slot = m_slots[sequenceNumber % Capacity];
+    slot.sequenceNumber = sequenceNumber;
+    slot.size = size;
+    std::memcpy(slot.data, packet, size);
+}
+
+int RtpRetransmissionCache::copy(quint16 sequenceNumber, std::byte *data) const
+{
+    QMutexLocker locker(&m_mutex);
+    const Slot &slot = m_slots[sequenceNumber % Capacity];
+    if (slot.size == 0 || slot.sequenceNumber != sequenceNumber) {
+        return 0;
+    }
+
+    std::memcpy(data, slot.data, slot.size);
+    return slot.size;
+}
@@ -0,0 +1,38 @@
+#ifndef RTPRETRANSMISSIONCACHE_H
+#define RTPRETRANSMISSIONCACHE_H
+
+#include <QMutex>
+#include <QtGlobal>
+#include <array>
+#include "Network/RtpPacket.h"
+
+/**
+ * The last Capacity RTP packets of one stream, for answering NACKs. Slots
+ * are preallocated and indexed by sequence number, so storing a packet is
+ * one memcpy into memory that already exists. The sender stores, the
+ * network thread looks up; a mutex keeps the two apart.
+ */
+class RtpRetransmissionCache
+{
+public:
+    // 2.5 s of 20 ms frames.
+    static constexpr int Capacity = 128;
+
+    void store(quint16 sequenceNumber, const std::byte *packet, int size);
+
+    // Copies the packet into data, which must hold RtpPacket::MaxSize bytes.
+    // Returns its size, or 0 if it is no longer cached.
+    int copy(quint16 sequenceNumber, std::byte *data) const;
+
+private:
+    struct Slot {
+        quint16 sequenceNumber = 0;
+        int size = 0;
+        std::byte data[RtpPacket::MaxSize];
+    };
+
+    mutable QMutex                  m_mutex;
+    std::array<Slot, Capacity>      m_slots;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "RtpSenderStage.h"
+#include "Network/webrtc.h"
+
+RtpSenderStage::RtpSenderStage(WebRTC *webrtc)
+    : RtpSenderStage([webrtc](std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples) {
+        webrtc->broadcastPacket(packet, capacity, payloadSize, samplePosition, frameSamples);
+    })
+{
+}
+
+RtpSenderStage::RtpSenderStage(Broadcast broadcast)
+    : PipelineStage("rtp-sender"),
+    m_broadcast(std::move(broadcast)),
+    m_input(this, [this](const FrameRef<unsigned char> &frame) { send(frame); })
+{
+}
+
+void RtpSenderStage::send(const FrameRef<unsigned char> &frame)
+{
+    // No logging here: this runs for every packet on the capture thread.
+    if (frame->headroomSize() < Headroom || frame->size() > MaxPayloadSize) {
+        m_rejectedFrames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // The header goes right in front of the payload, in the headroom.
+    std::byte *packet = reinterpret_cast<std::byte *>(frame->data()) - Headroom;
+    m_broadcast(packet, Headroom + frame->size(), frame->size(), frame->samplePosition, frame->frameSamples);
+}
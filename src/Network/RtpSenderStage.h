@@ -0,0 +1,45 @@
+#ifndef RTPSENDERSTAGE_H
+#define RTPSENDERSTAGE_H
+
+#include <functional>
+#include "Network/RtpPacket.h"
+#include "Pipeline/PipelinePort.h"
+
+class WebRTC;
+
+/**
+ * Last stage of the send pipeline: packetizes every encoded frame and
+ * sends it to all connected peers. The RTP header is written into the
+ * frame's headroom, so the encoder's output goes to the track without a
+ * copy. Frames must come with at least Headroom bytes of headroom and at
+ * most MaxPayloadSize bytes of payload.
+ *
+ * Packets go to WebRTC::broadcastPacket(), or to any function with its
+ * signature, such as a benchmark's own set of streams.
+ */
+class RtpSenderStage : public PipelineStage
+{
+public:
+    static constexpr int Headroom = RtpHeader::FixedSize;
+    static constexpr int MaxPayloadSize = RtpPacket::MaxPayloadSize;
+
+    using Broadcast = std::function<void(std::byte *packet, int capacity, int payloadSize,
+                                         quint64 samplePosition, int frameSamples)>;
+
+    explicit RtpSenderStage(WebRTC *webrtc);
+    explicit RtpSenderStage(Broadcast broadcast);
+
+    InputPort<unsigned char> &input() { return m_input; }
+
+    // Frames that could not be sent as they were.
+    quint64 rejectedFrames() const { return m_rejectedFrames.load(std::memory_order_relaxed); }
+
+private:
+    void send(const FrameRef<unsigned char> &frame);
+
+    Broadcast                   m_broadcast;
+    InputPort<unsigned char>    m_input;
+    std::atomic<quint64>        m_rejectedFrames{0};
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "RtpStream.h"
+#include <QDebug>
+#include <QRandomGenerator>
+#include <chrono>
+
+RtpStream::RtpStream(std::shared_ptr<rtc::Track> track, quint32 ssrc, quint8 payloadType)
+    : m_track(std::move(track)),
+    m_ssrc(ssrc),
+    m_payloadType(payloadType),
+    m_sequenceNumber(quint16(QRandomGenerator::global()->generate())),
+    m_timestamper(QRandomGenerator::global()->generate())
+{
+}
+
+bool RtpStream::send(std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples)
+{
+    RtpHeader header;
+    header.payloadType = m_payloadType;
+    header.sequenceNumber = m_sequenceNumber++;
+    header.timestamp = m_timestamper.timestamp(samplePosition, frameSamples, &header.marker);
+    header.ssrc = m_ssrc;
+    const int headerSize = header.write(reinterpret_cast<unsigned char *>(packet), capacity);
+    if (headerSize != RtpHeader::FixedSize) {
+        return false;
+    }
+
+    m_retransmissionCache.store(header.sequenceNumber, packet, headerSize + payloadSize);
+
+    if (!transmit(packet, headerSize + payloadSize)) {
+        return false;
+    }
+
+    m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+    m_octetsSent.fetch_add(quint64(payloadSize), std::memory_order_relaxed);
+    m_lastTimestamp.store(header.timestamp, std::memory_order_relaxed);
+    m_lastSendUs.store(clockUs(), std::memory_order_relaxed);
+    return true;
+}
+
+bool RtpStream::retransmit(quint16 sequenceNumber)
+{
+    std::byte packet[RtpPacket::MaxSize];
+    const int size = m_retransmissionCache.copy(sequenceNumber, packet);
+    if (size == 0) {
+        return false;
+    }
+
+    if (!transmit(packet, size)) {
+        return false;
+    }
+
+    m_packetsRetransmitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool RtpStream::transmit(const std::byte *packet, int size)
+{
+    const std::shared_ptr<rtc::Track> track = this->track();
+    if (!track) {
+        return false;
+    }
+
+    try {
+        track->send(packet, std::size_t(size));
+    } catch (const std::exception &e) {
+        qWarning() << "Error sending RTP packet on SSRC" << m_ssrc << ":" << e.what();
+        return false;
+    }
+    return true;
+}
+
+void RtpStream::setTrack(std::shared_ptr<rtc::Track> track)
+{
+    std::atomic_store(&m_track, std::move(track));
+}
+
+std::shared_ptr<rtc::Track> RtpStream::track() const
+{
+    return std::atomic_load(&m_track);
+}
+
+qint64 RtpStream::clockUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,74 @@
+#ifndef RTPSTREAM_H
+#define RTPSTREAM_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <rtc/rtc.hpp>
+#include "Network/RtpPacket.h"
+#include "Network/RtpRetransmissionCache.h"
+
+/**
+ * Outgoing RTP stream to one peer. Each stream has its own SSRC and random
+ * sequence and timestamp bases (RFC 3550 5.1), so several peers, calls or
+ * WebRTC instances in one process never share a sequence space. send() is
+ * meant for a single sending thread; the counters can be read from any
+ * thread. Packets leave through transmit(), which a benchmark can override
+ * to keep the network out of its numbers.
+ */
+class RtpStream
+{
+public:
+    RtpStream(std::shared_ptr<rtc::Track> track, quint32 ssrc, quint8 payloadType);
+    virtual ~RtpStream() = default;
+
+    // packet holds the payload behind RtpHeader::FixedSize bytes of
+    // headroom, capacity bytes in all; the header is written in place.
+    bool send(std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples);
+
+    // Sends a cached packet again, unchanged, in answer to a NACK. Called
+    // on the network thread. False if the packet has left the cache.
+    bool retransmit(quint16 sequenceNumber);
+
+    // Where the frame following the last one sent starts.
+    quint64 nextSamplePosition() const { return m_timestamper.nextPosition(); }
+
+    void setTrack(std::shared_ptr<rtc::Track> track);
+    std::shared_ptr<rtc::Track> track() const;
+
+    quint32 ssrc() const { return m_ssrc; }
+    quint64 packetsSent() const { return m_packetsSent.load(std::memory_order_relaxed); }
+    // Payload octets, as counted by RTCP sender reports.
+    quint64 octetsSent() const { return m_octetsSent.load(std::memory_order_relaxed); }
+    quint64 packetsRetransmitted() const { return m_packetsRetransmitted.load(std::memory_order_relaxed); }
+    quint32 lastTimestamp() const { return m_lastTimestamp.load(std::memory_order_relaxed); }
+    // clockUs() of the last send, 0 before the first packet.
+    qint64 lastSendUs() const { return m_lastSendUs.load(std::memory_order_relaxed); }
+
+    // Monotonic clock shared by the RTP and RTCP code.
+    static qint64 clockUs();
+
+protected:
+    // Hands a finished packet to the track. False if there is no track or
+    // it refused the packet.
+    virtual bool transmit(const std::byte *packet, int size);
+
+private:
+    std::shared_ptr<rtc::Track>     m_track;
+    quint32                         m_ssrc;
+    quint8                          m_payloadType;
+    quint16                         m_sequenceNumber;
+    RtpTimestamper                  m_timestamper;
+    RtpRetransmissionCache          m_retransmissionCache;
+
+    std::atomic<quint64>            m_packetsSent{0};
+    std::atomic<quint64>            m_octetsSent{0};
+    std::atomic<quint64>            m_packetsRetransmitted{0};
+    std::atomic<quint32>            m_lastTimestamp{0};
+    std::atomic<qint64>             m_lastSendUs{0};
+};
+
+// Held by the sender so that sending does not look the peer up per packet.
+using RtpStreamHandle = std::shared_ptr<RtpStream>;
+
+#endif
@@ -1,41 +1,47 @@
 #include "webrtc.h"
-#include <QtEndian>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cstring>
+#include "opus.h"
 
 static_assert(true);
 
-#pragma pack(push, 1)
-struct RtpHeader {
-    uint8_t first;
-    uint8_t marker:1;
-    uint8_t payloadType:7;
-    uint16_t sequenceNumber;
-    uint32_t timestamp;
-    uint32_t ssrc;
-};
-#pragma pack(pop)
-
+// Opus always runs a 48 kHz RTP clock, whatever the coded bandwidth (RFC 7587 4.1).
+static constexpr int OpusClockRate = 48000;
 
 WebRTC::WebRTC(QObject *parent)
     : QObject{parent},
     m_audio("Audio")
 {
+    // Without trickle ICE the description is only sent once it carries
+    // every candidate.
     connect(this, &WebRTC::gatheringComplited, [this] (const QString &peerID) {
+        if (m_trickleIce)
+            return;
 
-        m_localDescription = descriptionToJson(m_peerConnections[peerID]->localDescription().value());
-        Q_EMIT localDescriptionGenerated(peerID, m_localDescription);
+        emitGatheredDescription(peerID, true);
+    });
 
-        if (m_isOfferer)
-            Q_EMIT this->offerIsReady(peerID, m_localDescription);
-        else
-            Q_EMIT this->answerIsReady(peerID, m_localDescription);
+    m_rtcpTimer = new QTimer(this);
+    m_rtcpTimer->setSingleShot(true);
+    connect(m_rtcpTimer, &QTimer::timeout, this, [this] () {
+        sendRtcpReports();
+        m_rtcpTimer->start(RtcpIntervalMs / 2 + QRandomGenerator::global()->bounded(RtcpIntervalMs));
     });
+    m_rtcpTimer->start(RtcpIntervalMs);
+
+    // One thread is enough: closes are rare and must not pile up threads.
+    m_teardownPool.setMaxThreadCount(1);
 }
 
 WebRTC::~WebRTC()
-{}
+{
+    // Teardown tasks emit on this object.
+    m_teardownPool.waitForDone();
+}
 
 
 /**
@@ -49,9 +55,6 @@ void WebRTC::init(const QString &id, bool isOfferer)
     m_localId = id;
     m_isOfferer = isOfferer;
 
-    m_config = rtc::Configuration();
-    m_config.iceServers.push_back(rtc::IceServer{"stun:stun.l.google.com:19302"});
-
     m_audio = rtc::Description::Audio("audio");
     m_audio.setBitrate(m_bitRate);
 
@@ -61,154 +64,257 @@ void WebRTC::init(const QString &id, bool isOfferer)
              << ", as" << (isOfferer ? "offerer" : "answerer")
              << ", with payload type:" << m_payloadType
              << ", and bit rate:" << m_bitRate;
+
+    resetPeerPool();
 }
 
 void WebRTC::addPeer(const QString &peerId)
 {
-    auto newPeer = std::make_shared<rtc::PeerConnection>(m_config);
-    m_peerConnections.insert(peerId, newPeer);
+    // The same peer calling again replaces its previous connection.
+    if (findPeer(peerId)) {
+        removePeer(peerId);
+    }
 
-    newPeer->onLocalDescription([this, peerId](const rtc::Description &description) {
-        m_localDescription = descriptionToJson(description);
-    });
+    PeerContextHandle peer = takePooledPeer();
+    if (peer) {
+        qDebug() << "Using a pre-warmed peer connection for" << peerId;
+    } else {
+        peer = createPeer();
+    }
 
-    newPeer->onLocalCandidate([this, peerId](rtc::Candidate candidate) {
-        QString candidateStr = QString::fromStdString(candidate.candidate());
-        QString sdpMid = QString::fromStdString(candidate.mid());
-        Q_EMIT localCandidateGenerated(peerId, candidateStr, sdpMid);
-    });
+    {
+        QMutexLocker locker(&m_gatheredMutex);
+        m_gatheredPeers.remove(peerId);
+    }
+    // Callbacks of the connection look the peer up by ID, so it must be in
+    // the map before they can see the ID.
+    {
+        QMutexLocker locker(&m_peersMutex);
+        m_peers.insert(peerId, peer);
+    }
+    peer->setPeerId(peerId);
 
-    newPeer->onStateChange([this, peerId](rtc::PeerConnection::State state) {
-        switch (state) {
-        case rtc::PeerConnection::State::New:
-            qDebug() << "Peer" << peerId << "connection state: New";
-            break;
-        case rtc::PeerConnection::State::Connecting:
-            qDebug() << "Peer" << peerId << "connection state: Connecting";
-            break;
-        case rtc::PeerConnection::State::Connected:
-            qDebug() << "Peer" << peerId << "connection state: Connected";
-            Q_EMIT openedDataChannel(peerId);
-            break;
-        case rtc::PeerConnection::State::Disconnected:
-            qDebug() << "Peer" << peerId << "connection state: Disconnected";
-            break;
-        case rtc::PeerConnection::State::Failed:
-            qDebug() << "Peer" << peerId << "connection state: Failed";
-            break;
-        case rtc::PeerConnection::State::Closed:
-            qDebug() << "Peer" << peerId << "connection state: Closed";
-            break;
-        }
-    });
+    // Refill in the background; this may run on the signaling thread.
+    QMetaObject::invokeMethod(this, [this]() { fillPeerPool(); }, Qt::QueuedConnection);
+}
 
-    newPeer->onGatheringStateChange([this, peerId](rtc::PeerConnection::GatheringState state) {
-        if (state == rtc::PeerConnection::GatheringState::Complete) {
-            m_gatheringComplited = true;
-            Q_EMIT gatheringComplited(peerId);
-            qDebug() << "Gathering completed for peer" << peerId;
-        }
-    });
+bool WebRTC::removePeer(const QString &peerId)
+{
+    setStreamConnected(peerId, false);
 
-    newPeer->onTrack([this, peerId] (std::shared_ptr<rtc::Track> track) {
-        m_peerTracks[peerId] = track;
-        track->onMessage([this, peerId](rtc::message_variant data) {
-            QByteArray packet = readVariant(data);
-            Q_EMIT incommingPacket(peerId, packet, packet.size());
-        });
-        qDebug() << "Incoming track received for peer" << peerId;
-    });
+    PeerContextHandle peer;
+    {
+        QMutexLocker locker(&m_peersMutex);
+        peer = m_peers.take(peerId);
+    }
+    if (!peer) {
+        qWarning() << "Peer connection not found for peerID:" << peerId;
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_gatheredMutex);
+        m_gatheredPeers.remove(peerId);
+    }
+    m_pendingCandidates.remove(peerId);
 
-    addAudioTrack(peerId, "m=audio 49170 UDP/TLS/RTP/SAVPF 111");
+    // Whatever the connection still reports belongs to no call any more.
+    peer->setPeerId(QString());
+    closePeer(peer, peerId);
+
+    qDebug() << "Removed peer" << peerId << ", closing in the background";
+    return true;
+}
+
+QStringList WebRTC::peerIds() const
+{
+    QMutexLocker locker(&m_peersMutex);
+    return m_peers.keys();
 }
 
 void WebRTC::generateOfferSDP(const QString &peerId)
 {
-    auto it = m_peerConnections.find(peerId);
-    if (it == m_peerConnections.end()) {
+    PeerContextHandle peer = findPeer(peerId);
+    if (!peer) {
         qWarning() << "Peer connection not found for peerID:" << peerId;
         return;
     }
 
-    auto peerConnection = it.value();
-    peerConnection->setLocalDescription(rtc::Description::Type::Offer);
+    // A pooled connection made its offer and started gathering ahead of
+    // time; only signaling is left.
+    if (std::optional<rtc::Description> description = peer->peerConnection->localDescription()) {
+        qDebug() << "Using the pre-gathered SDP offer for peer ID:" << peerId;
+        if (m_trickleIce) {
+            emitLocalDescription(peerId, *description);
+        } else if (peer->peerConnection->gatheringState() == rtc::PeerConnection::GatheringState::Complete) {
+            emitGatheredDescription(peerId, true);
+        } else if (m_iceSettings.gatheringTimeoutMs > 0) {
+            scheduleGatheringTimeout(peerId, m_iceSettings.gatheringTimeoutMs);
+        }
+        return;
+    }
+
+    peer->peerConnection->setLocalDescription(rtc::Description::Type::Offer);
 
     qDebug() << "Generated SDP offer for peer ID:" << peerId;
 }
 
 void WebRTC::generateAnswerSDP(const QString &peerId)
 {
-    auto it = m_peerConnections.find(peerId);
-    if (it == m_peerConnections.end()) {
+    PeerContextHandle peer = findPeer(peerId);
+    if (!peer) {
         qWarning() << "Peer connection not found for peerID:" << peerId;
         return;
     }
 
-    auto peerConnection = it.value();
-
-    peerConnection->localDescription()->generateSdp();
+    peer->peerConnection->localDescription()->generateSdp();
 
     qDebug() << "Generated SDP answer for peer ID:" << peerId;
 }
 
 void WebRTC::addAudioTrack(const QString &peerId, const QString &trackName)
 {
-    if (!m_peerConnections.contains(peerId)) {
+    PeerContextHandle peer = findPeer(peerId);
+    if (!peer) {
         qWarning() << "Peer connection for" << peerId << "does not exist.";
         return;
     }
 
-    auto peerConnection = m_peerConnections[peerId];
+    addAudioTrack(peer, trackName);
+    qDebug() << "Added audio track for peer:" << peerId << "with track name:" << trackName;
+}
 
-    auto audioTrack = peerConnection->addTrack(rtc::Description::Media(trackName.toStdString(), "audio", rtc::Description::Direction::SendRecv));
+void WebRTC::sendTrack(const QString &peerId, const QByteArray &buffer)
+{
+    RtpStreamHandle peerStream = stream(peerId);
+    if (!peerStream) {
+        qWarning() << "Stream not found for peerID:" << peerId;
+        return;
+    }
 
-    m_peerTracks[peerId] = audioTrack;
+    const int frameSamples = opus_packet_get_nb_samples(reinterpret_cast<const unsigned char *>(buffer.constData()),
+                                                        buffer.size(), OpusClockRate);
+    if (frameSamples <= 0) {
+        qWarning() << "Not sending malformed Opus packet to peer" << peerId;
+        return;
+    }
 
-    audioTrack->onMessage([this, peerId](rtc::message_variant data) {
-        QByteArray packet = readVariant(data);
-        Q_EMIT incommingPacket(peerId, packet, packet.size());
-        qDebug() << "Received audio message with timestamp:";
-    });
+    if (buffer.size() > RtpPacket::MaxPayloadSize) {
+        qWarning() << "RTP payload of" << buffer.size() << "bytes does not fit into a packet, dropped";
+        return;
+    }
 
-    audioTrack->onFrame([this](rtc::binary frame, rtc::FrameInfo info) {
-        qDebug() << "Received audio frame with timestamp:" << info.timestamp;
-    });
+    // No capture position here: continue right after the previous packet.
+    std::byte packet[RtpPacket::MaxSize];
+    std::memcpy(packet + RtpHeader::FixedSize, buffer.constData(), buffer.size());
+    peerStream->send(packet, RtpPacket::MaxSize, buffer.size(), peerStream->nextSamplePosition(), frameSamples);
+}
 
-    qDebug() << "Added audio track for peer:" << peerId << "with track name:" << trackName;
+RtpStreamHandle WebRTC::stream(const QString &peerId) const
+{
+    PeerContextHandle peer = findPeer(peerId);
+    return peer ? peer->stream : nullptr;
 }
 
-void WebRTC::sendTrack(const QString &peerId, const QByteArray &buffer)
+void WebRTC::broadcastPacket(std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples)
 {
-    auto peerConnectionIt = m_peerConnections.find(peerId);
-    auto peerTrackIt = m_peerTracks.find(peerId);
-    if (peerConnectionIt == m_peerConnections.end() || peerTrackIt == m_peerTracks.end()) {
-        qWarning() << "Peer connection or track not found for peerID:" << peerId;
+    // Track::send() is done with the buffer when it returns, so the next
+    // peer's header can go over the previous one.
+    const auto streams = std::atomic_load(&m_connectedStreams);
+    if (!streams) {
         return;
     }
+    for (const RtpStreamHandle &stream : *streams) {
+        stream->send(packet, capacity, payloadSize, samplePosition, frameSamples);
+    }
+}
 
-    RtpHeader rtpHeader;
-    rtpHeader.first = 0x80;
-    rtpHeader.marker = 0;
-    rtpHeader.payloadType = m_payloadType;
-    rtpHeader.sequenceNumber = qToBigEndian(m_sequenceNumber++);
-    rtpHeader.timestamp = qToBigEndian(getCurrentTimestamp());
-    rtpHeader.ssrc = qToBigEndian(m_ssrc);
+int WebRTC::connectedStreamCount() const
+{
+    const auto streams = std::atomic_load(&m_connectedStreams);
+    return streams ? int(streams->size()) : 0;
+}
 
-    QByteArray rtpPacket;
-    rtpPacket.append(reinterpret_cast<const char*>(&rtpHeader), sizeof(RtpHeader));
-    rtpPacket.append(buffer);
+PeerRtpStats WebRTC::peerStats(const QString &peerId) const
+{
+    PeerContextHandle peer = findPeer(peerId);
+    return peer ? peer->session->stats() : PeerRtpStats();
+}
 
-    std::vector<std::byte> packetData(rtpPacket.size());
-    std::transform(rtpPacket.begin(), rtpPacket.end(), packetData.begin(), [](char c) {
-        return static_cast<std::byte>(c);
-    });
+QVariantMap WebRTC::callStats() const
+{
+    QVariantMap result;
+    const QMap<QString, PeerContextHandle> peers = this->peers();
+    for (auto it = peers.cbegin(); it != peers.cend(); ++it) {
+        const PeerRtpStats stats = it.value()->session->stats();
+
+        QVariantMap peer;
+        peer["packetsSent"] = stats.packetsSent;
+        peer["bytesSent"] = stats.bytesSent;
+        peer["packetsReceived"] = stats.packetsReceived;
+        peer["bytesReceived"] = stats.bytesReceived;
+        peer["fractionLost"] = stats.fractionLost;
+        peer["packetsLost"] = stats.packetsLost;
+        peer["remoteJitterMs"] = stats.remoteJitterMs;
+        peer["rttMs"] = stats.rttMs;
+        peer["remoteReceiveRate"] = stats.remoteReceiveRate;
+        peer["receiveFractionLost"] = stats.receiveFractionLost;
+        peer["receivePacketsLost"] = stats.receivePacketsLost;
+        peer["jitterMs"] = stats.jitterMs;
+        peer["nacksReceived"] = stats.nacksReceived;
+        peer["packetsRetransmitted"] = stats.packetsRetransmitted;
+        peer["nacksSent"] = stats.nacksSent;
+        peer["packetsRecovered"] = stats.packetsRecovered;
+        result[it.key()] = peer;
+    }
+    return result;
+}
 
-    try {
-        peerTrackIt.value()->send(packetData);
-        qDebug() << "Sent RTP packet to peer" << peerId << "with size:" << rtpPacket.size();
-    } catch (const std::exception &e) {
-        qWarning() << "Error sending RTP packet to peer" << peerId << ":" << e.what();
+bool WebRTC::setIceSettings(const IceSettings &settings)
+{
+    if (!settings.isValid()) {
+        qWarning() << "Ignoring invalid ICE settings, port range" << settings.portRangeBegin << "-" << settings.portRangeEnd;
+        return false;
     }
+
+    m_iceSettings = settings;
+    resetPeerPool();
+    return true;
+}
+
+IceSettings WebRTC::iceSettings() const
+{
+    return m_iceSettings;
+}
+
+void WebRTC::setPlayoutDelayMs(int delayMs)
+{
+    m_playoutDelayMs = delayMs;
+    for (const PeerContextHandle &peer : peers()) {
+        peer->session->setPlayoutDelayMs(delayMs);
+    }
+
+    QMutexLocker locker(&m_peerPoolMutex);
+    for (const PeerContextHandle &peer : std::as_const(m_peerPool)) {
+        peer->session->setPlayoutDelayMs(delayMs);
+    }
+}
+
+int WebRTC::peerPoolSize() const
+{
+    return m_peerPoolSize;
+}
+
+void WebRTC::setPeerPoolSize(int newPeerPoolSize)
+{
+    m_peerPoolSize = qMax(0, newPeerPoolSize);
+    Q_EMIT peerPoolSizeChanged();
+    resetPeerPool();
+}
+
+void WebRTC::resetPeerPoolSize()
+{
+    setPeerPoolSize(1);
 }
 
 
@@ -220,22 +326,27 @@ void WebRTC::sendTrack(const QString &peerId, const QByteArray &buffer)
 
 void WebRTC::setRemoteDescription(const QString &peerID, const QString &sdp)
 {
-    auto it = m_peerConnections.find(peerID);
-    if (it == m_peerConnections.end()) {
+    PeerContextHandle peer = findPeer(peerID);
+    if (!peer) {
         qWarning() << "Peer connection not found for peerID:" << peerID;
         return;
     }
     std::string sdpStr = sdp.toStdString();
     rtc::Description remoteDescription(sdpStr, m_isOfferer ? rtc::Description::Type::Answer : rtc::Description::Type::Offer);
-    it.value()->setRemoteDescription(remoteDescription);
+    peer->peerConnection->setRemoteDescription(remoteDescription);
 
     qDebug() << "Set remote description for peerID:" << peerID;
+
+    const QList<rtc::Candidate> pending = m_pendingCandidates.take(peerID);
+    for (const rtc::Candidate &candidate : pending) {
+        addRemoteCandidate(peer->peerConnection, peerID, candidate);
+    }
 }
 
 void WebRTC::setRemoteCandidate(const QString &peerID, const QString &candidate, const QString &sdpMid)
 {
-    auto it = m_peerConnections.find(peerID);
-    if (it == m_peerConnections.end()) {
+    PeerContextHandle peer = findPeer(peerID);
+    if (!peer) {
         qWarning() << "Peer connection not found for peerID:" << peerID;
         return;
     }
@@ -245,11 +356,15 @@ void WebRTC::setRemoteCandidate(const QString &peerID, const QString &candidate,
 
     rtc::Candidate rtcCandidate(candidateStr, sdpMidStr);
 
-    it.value()->addRemoteCandidate(rtcCandidate);
+    // Trickled candidates can overtake the description they belong to;
+    // hold them until setRemoteDescription().
+    if (!peer->peerConnection->remoteDescription()) {
+        m_pendingCandidates[peerID].append(rtcCandidate);
+        qDebug() << "Queued remote candidate for peerID:" << peerID << "until its description arrives";
+        return;
+    }
 
-    qDebug() << "Added remote candidate for peerID:" << peerID
-             << " with candidate:" << candidate
-             << " and sdpMid:" << sdpMid;
+    addRemoteCandidate(peer->peerConnection, peerID, rtcCandidate);
 }
 
 
@@ -259,31 +374,386 @@ void WebRTC::setRemoteCandidate(const QString &peerID, const QString &candidate,
  * ====================================================
  */
 
-QByteArray WebRTC::readVariant(const rtc::message_variant &data)
+void WebRTC::readRtpMessage(const QString &peerId, const rtc::message_variant &data, RtcpSession &session)
 {
-    QByteArray result;
+    if (!std::holds_alternative<rtc::binary>(data)) {
+        qWarning() << "Ignoring non-binary message on the audio track of peer" << peerId;
+        return;
+    }
+
+    const rtc::binary &message = std::get<rtc::binary>(data);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(message.data());
+    const int size = int(message.size());
 
-    if (std::holds_alternative<std::string>(data)) {
-        const auto &str = std::get<std::string>(data);
-        result = QByteArray::fromStdString(str);
+    if (RtpPacket::isRtcp(bytes, size)) {
+        if (session.onRtcpPacket(bytes, size)) {
+            const PeerRtpStats stats = session.stats();
+            Q_EMIT networkFeedback(peerId, stats.fractionLost, stats.rttMs, stats.remoteReceiveRate);
+        }
+        return;
     }
-    else if (std::holds_alternative<rtc::binary>(data)) {
-        const rtc::binary &binaryData = std::get<rtc::binary>(data);
-        result = QByteArray(reinterpret_cast<const char*>(binaryData.data()), binaryData.size());
-    } else {
-        qWarning() << "Unsupported data type in rtc::message_variant";
-        return result;
+
+    RtpPacket packet;
+    if (!packet.parse(bytes, size)) {
+        qWarning() << "Dropping malformed RTP packet of" << size << "bytes from peer" << peerId;
+        return;
     }
 
-    const int rtpHeaderSize = sizeof(RtpHeader);
+    const quint32 sequenceNumber = session.onRtpPacket(packet);
+
+    // Ask for whatever this packet showed to be missing right away; waiting
+    // for the next report would eat most of the playout delay.
+    unsigned char nack[RtcpSession::MaxReportSize];
+    const int nackSize = session.writeNack(nack, sizeof(nack));
+    if (nackSize > 0) {
+        std::shared_ptr<rtc::Track> track = session.stream()->track();
+        try {
+            if (track) {
+                track->send(reinterpret_cast<const std::byte *>(nack), std::size_t(nackSize));
+            }
+        } catch (const std::exception &e) {
+            qWarning() << "Error sending NACK to peer" << peerId << ":" << e.what();
+        }
+    }
 
-    if (result.size() >= rtpHeaderSize) {
-        result = result.mid(rtpHeaderSize);
-    } else {
-        qWarning() << "Data size is smaller than RTP header size. Unable to remove header.";
+    // Straight into the jitter buffer's queue from this thread when there is
+    // a sink; the signal is for consumers that want the event loop.
+    if (ReceivedFrameSink *sink = m_receivedFrameSink.load(std::memory_order_acquire)) {
+        sink->frameReceived(packet.header.ssrc, packet.payload, packet.payloadSize,
+                            packet.header.sequenceNumber, packet.header.timestamp);
+        return;
     }
 
-    return result;
+    QByteArray payload(reinterpret_cast<const char *>(packet.payload), packet.payloadSize);
+    Q_EMIT incommingPacket(peerId, payload, payload.size(), sequenceNumber, packet.header.timestamp);
+}
+
+void WebRTC::sendRtcpReports()
+{
+    unsigned char report[RtcpSession::MaxReportSize];
+
+    const QMap<QString, PeerContextHandle> peers = this->peers();
+    for (auto it = peers.cbegin(); it != peers.cend(); ++it) {
+        std::shared_ptr<rtc::Track> track = it.value()->stream->track();
+        if (!track || !track->isOpen()) {
+            continue;
+        }
+
+        const int size = it.value()->session->writeReport(report, sizeof(report));
+        if (size == 0) {
+            continue;
+        }
+
+        // libdatachannel tells RTCP from RTP by the packet type byte and
+        // protects it with SRTCP.
+        try {
+            track->send(reinterpret_cast<const std::byte *>(report), std::size_t(size));
+        } catch (const std::exception &e) {
+            qWarning() << "Error sending RTCP report to peer" << it.key() << ":" << e.what();
+        }
+    }
+
+    if (!peers.isEmpty()) {
+        Q_EMIT callStatsChanged();
+    }
+}
+
+// Empty while the connection waits in the pool, or once it is gone.
+static QString peerIdOf(const std::weak_ptr<PeerContext> &weakPeer)
+{
+    PeerContextHandle peer = weakPeer.lock();
+    return peer ? peer->peerId() : QString();
+}
+
+PeerContextHandle WebRTC::createPeer()
+{
+    auto peer = std::make_shared<PeerContext>();
+    peer->peerConnection = std::make_shared<rtc::PeerConnection>(iceConfiguration());
+    // The callbacks are owned by the connection, which the context owns.
+    std::weak_ptr<PeerContext> weakPeer = peer;
+
+    // With trickle ICE the description goes out right away and the
+    // candidates follow one by one through localCandidateGenerated.
+    // Otherwise it waits for gathering, at most gatheringTimeoutMs. A pooled
+    // connection signals nothing until a call claims it.
+    const int gatheringTimeoutMs = m_iceSettings.gatheringTimeoutMs;
+    peer->peerConnection->onLocalDescription([this, weakPeer, gatheringTimeoutMs](const rtc::Description &description) {
+        const QString peerId = peerIdOf(weakPeer);
+        if (peerId.isEmpty())
+            return;
+
+        m_localDescription = descriptionToJson(description);
+        if (m_trickleIce) {
+            emitLocalDescription(peerId, description);
+        } else if (gatheringTimeoutMs > 0) {
+            scheduleGatheringTimeout(peerId, gatheringTimeoutMs);
+        }
+    });
+
+    peer->peerConnection->onLocalCandidate([this, weakPeer](rtc::Candidate candidate) {
+        const QString peerId = peerIdOf(weakPeer);
+        if (peerId.isEmpty())
+            return;
+
+        QString candidateStr = QString::fromStdString(candidate.candidate());
+        QString sdpMid = QString::fromStdString(candidate.mid());
+        Q_EMIT localCandidateGenerated(peerId, candidateStr, sdpMid);
+    });
+
+    peer->peerConnection->onStateChange([this, weakPeer](rtc::PeerConnection::State state) {
+        const QString peerId = peerIdOf(weakPeer);
+        switch (state) {
+        case rtc::PeerConnection::State::New:
+            qDebug() << "Peer" << peerId << "connection state: New";
+            break;
+        case rtc::PeerConnection::State::Connecting:
+            qDebug() << "Peer" << peerId << "connection state: Connecting";
+            break;
+        case rtc::PeerConnection::State::Connected:
+            qDebug() << "Peer" << peerId << "connection state: Connected";
+            setStreamConnected(peerId, true);
+            Q_EMIT openedDataChannel(peerId);
+            break;
+        case rtc::PeerConnection::State::Disconnected:
+            qDebug() << "Peer" << peerId << "connection state: Disconnected";
+            setStreamConnected(peerId, false);
+            break;
+        case rtc::PeerConnection::State::Failed:
+            qDebug() << "Peer" << peerId << "connection state: Failed";
+            setStreamConnected(peerId, false);
+            break;
+        case rtc::PeerConnection::State::Closed:
+            qDebug() << "Peer" << peerId << "connection state: Closed";
+            setStreamConnected(peerId, false);
+            break;
+        }
+    });
+
+    peer->peerConnection->onGatheringStateChange([this, weakPeer](rtc::PeerConnection::GatheringState state) {
+        if (state != rtc::PeerConnection::GatheringState::Complete)
+            return;
+
+        m_gatheringComplited = true;
+        const QString peerId = peerIdOf(weakPeer);
+        if (peerId.isEmpty()) {
+            qDebug() << "Gathering completed for a pooled peer connection";
+            return;
+        }
+        Q_EMIT gatheringComplited(peerId);
+        qDebug() << "Gathering completed for peer" << peerId;
+    });
+
+    peer->peerConnection->onTrack([this, weakPeer] (std::shared_ptr<rtc::Track> track) {
+        PeerContextHandle peer = weakPeer.lock();
+        if (!peer) {
+            return;
+        }
+        peer->setTrack(track);
+        if (peer->stream) {
+            peer->stream->setTrack(track);
+        }
+        if (std::shared_ptr<RtcpSession> session = peer->session) {
+            track->onMessage([this, weakPeer, session](rtc::message_variant data) {
+                readRtpMessage(peerIdOf(weakPeer), data, *session);
+            });
+        }
+        qDebug() << "Incoming track received for peer" << peer->peerId();
+    });
+
+    addAudioTrack(peer, "audio");
+    return peer;
+}
+
+void WebRTC::addAudioTrack(const PeerContextHandle &peer, const QString &trackName)
+{
+    // A fixed SSRC is only meant for debugging; normally every stream picks
+    // its own so that peers can be told apart.
+    rtc::SSRC ssrc = m_ssrc;
+    while (ssrc == 0) {
+        ssrc = QRandomGenerator::global()->generate();
+    }
+
+    rtc::Description::Audio audio(trackName.toStdString(), rtc::Description::Direction::SendRecv);
+    audio.addOpusCodec(m_payloadType, opusFormatParameters());
+    // Lost packets are asked for again with generic NACKs (RFC 4585).
+    audio.rtpMap(m_payloadType)->addFeedback("nack");
+    audio.setBitrate(m_bitRate / 1000);
+    audio.addSSRC(ssrc, m_localId.toStdString());
+
+    auto audioTrack = peer->peerConnection->addTrack(audio);
+
+    peer->setTrack(audioTrack);
+    peer->stream = std::make_shared<RtpStream>(audioTrack, ssrc, quint8(m_payloadType));
+    peer->session = std::make_shared<RtcpSession>(peer->stream, m_localId.toStdString());
+    peer->session->setPlayoutDelayMs(m_playoutDelayMs);
+
+    std::weak_ptr<PeerContext> weakPeer = peer;
+    std::shared_ptr<RtcpSession> session = peer->session;
+    audioTrack->onMessage([this, weakPeer, session](rtc::message_variant data) {
+        readRtpMessage(peerIdOf(weakPeer), data, *session);
+    });
+
+    audioTrack->onFrame([this](rtc::binary frame, rtc::FrameInfo info) {
+        qDebug() << "Received audio frame with timestamp:" << info.timestamp;
+    });
+}
+
+PeerContextHandle WebRTC::findPeer(const QString &peerId) const
+{
+    QMutexLocker locker(&m_peersMutex);
+    return m_peers.value(peerId);
+}
+
+QMap<QString, PeerContextHandle> WebRTC::peers() const
+{
+    QMutexLocker locker(&m_peersMutex);
+    return m_peers;
+}
+
+PeerContextHandle WebRTC::takePooledPeer()
+{
+    QMutexLocker locker(&m_peerPoolMutex);
+    return m_peerPool.isEmpty() ? nullptr : m_peerPool.takeFirst();
+}
+
+void WebRTC::fillPeerPool()
+{
+    // The SDP carries the local ID, which init() sets.
+    if (m_localId.isEmpty()) {
+        return;
+    }
+
+    for (;;) {
+        {
+            QMutexLocker locker(&m_peerPoolMutex);
+            if (m_peerPool.size() >= m_peerPoolSize) {
+                return;
+            }
+        }
+
+        // The certificate and the ICE agent are set up here. An offer can
+        // also be made and gathered for ahead of time; an answer has to
+        // wait for the remote offer.
+        PeerContextHandle peer = createPeer();
+        if (m_isOfferer) {
+            peer->peerConnection->setLocalDescription(rtc::Description::Type::Offer);
+        }
+
+        QMutexLocker locker(&m_peerPoolMutex);
+        m_peerPool.append(peer);
+    }
+}
+
+void WebRTC::resetPeerPool()
+{
+    // Pooled connections were built from the old settings.
+    QList<PeerContextHandle> stale;
+    {
+        QMutexLocker locker(&m_peerPoolMutex);
+        stale.swap(m_peerPool);
+    }
+    for (const PeerContextHandle &peer : std::as_const(stale)) {
+        closePeer(peer, QString());
+    }
+
+    QMetaObject::invokeMethod(this, [this]() { fillPeerPool(); }, Qt::QueuedConnection);
+}
+
+void WebRTC::closePeer(const PeerContextHandle &peer, const QString &peerId)
+{
+    // Closing stops the DTLS and ICE transports and waits for them, and the
+    // last reference takes the connection's destructor with it; neither
+    // belongs on the GUI or signaling thread. The context is already out of
+    // every map, so a new call to the same peer can start right away.
+    m_teardownPool.start([this, peer, peerId]() {
+        peer->peerConnection->resetCallbacks();
+        if (std::shared_ptr<rtc::Track> track = peer->track()) {
+            track->close();
+        }
+        peer->peerConnection->close();
+
+        if (!peerId.isEmpty()) {
+            Q_EMIT peerClosed(peerId);
+        }
+    });
+}
+
+void WebRTC::scheduleGatheringTimeout(const QString &peerId, int timeoutMs)
+{
+    // May be called on a libdatachannel thread, which has no event loop.
+    QMetaObject::invokeMethod(this, [this, peerId, timeoutMs]() {
+        QTimer::singleShot(timeoutMs, this, [this, peerId]() {
+            emitGatheredDescription(peerId, false);
+        });
+    }, Qt::QueuedConnection);
+}
+
+void WebRTC::emitLocalDescription(const QString &peerId, const rtc::Description &description)
+{
+    m_localDescription = descriptionToJson(description);
+    Q_EMIT localDescriptionGenerated(peerId, m_localDescription);
+
+    if (m_isOfferer)
+        Q_EMIT offerIsReady(peerId, m_localDescription);
+    else
+        Q_EMIT answerIsReady(peerId, m_localDescription);
+}
+
+void WebRTC::emitGatheredDescription(const QString &peerId, bool complete)
+{
+    {
+        QMutexLocker locker(&m_gatheredMutex);
+        if (m_gatheredPeers.contains(peerId)) {
+            return;
+        }
+        m_gatheredPeers.insert(peerId);
+    }
+
+    PeerContextHandle peer = findPeer(peerId);
+    if (!peer) {
+        return;
+    }
+    std::optional<rtc::Description> description = peer->peerConnection->localDescription();
+    if (!description) {
+        return;
+    }
+
+    if (!complete) {
+        qDebug() << "Gathering timed out for peer" << peerId << "after" << m_iceSettings.gatheringTimeoutMs
+                 << "ms, signaling" << description->candidates().size() << "candidates";
+    }
+    emitLocalDescription(peerId, *description);
+}
+
+rtc::Configuration WebRTC::iceConfiguration() const
+{
+    rtc::Configuration config;
+    if (!m_iceSettings.hostOnly) {
+        for (const QString &server : m_iceSettings.servers) {
+            config.iceServers.emplace_back(server.toStdString());
+        }
+    }
+    config.portRangeBegin = m_iceSettings.portRangeBegin;
+    config.portRangeEnd = m_iceSettings.portRangeEnd;
+    if (!m_iceSettings.bindAddress.isEmpty()) {
+        config.bindAddress = m_iceSettings.bindAddress.toStdString();
+    }
+    return config;
+}
+
+void WebRTC::addRemoteCandidate(const std::shared_ptr<rtc::PeerConnection> &peerConnection, const QString &peerId,
+                                const rtc::Candidate &candidate)
+{
+    try {
+        peerConnection->addRemoteCandidate(candidate);
+    } catch (const std::exception &e) {
+        qWarning() << "Error adding remote candidate for peer" << peerId << ":" << e.what();
+        return;
+    }
+
+    qDebug() << "Added remote candidate for peerID:" << peerId
+             << " with candidate:" << QString::fromStdString(candidate.candidate())
+             << " and sdpMid:" << QString::fromStdString(candidate.mid());
 }
 
 QString WebRTC::descriptionToJson(const rtc::Description &description)
@@ -297,6 +767,42 @@ QString WebRTC::descriptionToJson(const rtc::Description &description)
     return QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
 }
 
+void WebRTC::setStreamConnected(const QString &peerId, bool connected)
+{
+    PeerContextHandle peer = findPeer(peerId);
+    if (!peer || !peer->stream) {
+        return;
+    }
+    const RtpStreamHandle &stream = peer->stream;
+
+    QMutexLocker locker(&m_connectedStreamsMutex);
+    const auto current = std::atomic_load(&m_connectedStreams);
+    auto streams = current ? std::make_shared<std::vector<RtpStreamHandle>>(*current)
+                           : std::make_shared<std::vector<RtpStreamHandle>>();
+
+    auto it = std::find(streams->begin(), streams->end(), stream);
+    if (connected && it == streams->end()) {
+        streams->push_back(stream);
+    } else if (!connected && it != streams->end()) {
+        streams->erase(it);
+    } else {
+        return;
+    }
+
+    std::atomic_store(&m_connectedStreams, std::shared_ptr<const std::vector<RtpStreamHandle>>(std::move(streams)));
+}
+
+std::string WebRTC::opusFormatParameters() const
+{
+    // RFC 7587 fmtp: tells the remote encoder what we can decode and what
+    // it should send.
+    return QString("maxaveragebitrate=%1;useinbandfec=%2;usedtx=%3")
+        .arg(m_bitRate)
+        .arg(m_inbandFec ? 1 : 0)
+        .arg(m_dtx ? 1 : 0)
+        .toStdString();
+}
+
 int WebRTC::bitRate() const
 {
     return m_bitRate;
@@ -304,26 +810,97 @@ int WebRTC::bitRate() const
 
 void WebRTC::setBitRate(int newBitRate)
 {
+    // The pooled connections only need rebuilding for a new value.
+    if (m_bitRate == newBitRate) {
+        return;
+    }
     m_bitRate = newBitRate;
     Q_EMIT bitRateChanged();
+    resetPeerPool();
 }
 
 void WebRTC::resetBitRate()
 {
-    m_bitRate = 48000;
-    Q_EMIT bitRateChanged();
+    setBitRate(48000);
+}
+
+void WebRTC::setSdpSettings(int newBitRate, bool newInbandFec, bool newDtx)
+{
+    const bool bitRateDiffers = m_bitRate != newBitRate;
+    const bool inbandFecDiffers = m_inbandFec != newInbandFec;
+    const bool dtxDiffers = m_dtx != newDtx;
+    if (!bitRateDiffers && !inbandFecDiffers && !dtxDiffers) {
+        return;
+    }
+
+    m_bitRate = newBitRate;
+    m_inbandFec = newInbandFec;
+    m_dtx = newDtx;
+    if (bitRateDiffers) {
+        Q_EMIT bitRateChanged();
+    }
+    if (inbandFecDiffers) {
+        Q_EMIT inbandFecChanged();
+    }
+    if (dtxDiffers) {
+        Q_EMIT dtxChanged();
+    }
+    resetPeerPool();
+}
+
+bool WebRTC::inbandFec() const
+{
+    return m_inbandFec;
+}
+
+void WebRTC::setInbandFec(bool newInbandFec)
+{
+    if (m_inbandFec == newInbandFec) {
+        return;
+    }
+    m_inbandFec = newInbandFec;
+    Q_EMIT inbandFecChanged();
+    resetPeerPool();
+}
+
+void WebRTC::resetInbandFec()
+{
+    setInbandFec(false);
+}
+
+bool WebRTC::dtx() const
+{
+    return m_dtx;
+}
+
+void WebRTC::setDtx(bool newDtx)
+{
+    if (m_dtx == newDtx) {
+        return;
+    }
+    m_dtx = newDtx;
+    Q_EMIT dtxChanged();
+    resetPeerPool();
+}
+
+void WebRTC::resetDtx()
+{
+    setDtx(false);
 }
 
 void WebRTC::setPayloadType(int newPayloadType)
 {
+    if (m_payloadType == newPayloadType) {
+        return;
+    }
     m_payloadType = newPayloadType;
     Q_EMIT payloadTypeChanged();
+    resetPeerPool();
 }
 
 void WebRTC::resetPayloadType()
 {
-    m_payloadType = 111;
-    Q_EMIT payloadTypeChanged();
+    setPayloadType(111);
 }
 
 rtc::SSRC WebRTC::ssrc() const
@@ -333,14 +910,17 @@ rtc::SSRC WebRTC::ssrc() const
 
 void WebRTC::setSsrc(rtc::SSRC newSsrc)
 {
+    if (m_ssrc == newSsrc) {
+        return;
+    }
     m_ssrc = newSsrc;
     Q_EMIT ssrcChanged();
+    resetPeerPool();
 }
 
 void WebRTC::resetSsrc()
 {
-    m_ssrc = 2;
-    Q_EMIT ssrcChanged();
+    setSsrc(0);
 }
 
 int WebRTC::payloadType() const
@@ -355,6 +935,23 @@ int WebRTC::payloadType() const
  * ====================================================
  */
 
+bool WebRTC::trickleIce() const
+{
+    return m_trickleIce;
+}
+
+void WebRTC::setTrickleIce(bool newTrickleIce)
+{
+    m_trickleIce = newTrickleIce;
+    Q_EMIT trickleIceChanged();
+}
+
+void WebRTC::resetTrickleIce()
+{
+    m_trickleIce = true;
+    Q_EMIT trickleIceChanged();
+}
+
 bool WebRTC::isOfferer() const
 {
     return m_isOfferer;
@@ -362,14 +959,17 @@ bool WebRTC::isOfferer() const
 
 void WebRTC::setIsOfferer(bool newIsOfferer)
 {
+    if (m_isOfferer == newIsOfferer) {
+        return;
+    }
     m_isOfferer = newIsOfferer;
     Q_EMIT isOffererChanged();
+    resetPeerPool();
 }
 
 void WebRTC::resetIsOfferer()
 {
-    m_isOfferer = false;
-    Q_EMIT isOffererChanged();
+    setIsOfferer(false);
 }
 
 
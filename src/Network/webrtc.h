@@ -3,23 +3,86 @@
 
 #include <QObject>
 #include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+#include <atomic>
+#include <vector>
 #include <rtc/rtc.hpp>
+#include "Audio/ReceivedFrameSink.h"
+#include "Network/IceSettings.h"
+#include "Network/PeerContext.h"
+#include "Network/RtpPacket.h"
+#include "Network/RtpStream.h"
+#include "Network/RtcpSession.h"
 
 class WebRTC : public QObject
 {
     Q_OBJECT
 
 public:
+    // Average RTCP report interval; each interval is randomized by +-50%.
+    static constexpr int RtcpIntervalMs = 1000;
+
     explicit WebRTC(QObject *parent = nullptr);
     virtual ~WebRTC();
 
     Q_INVOKABLE void init(const QString &id, bool isOfferer = false);
     Q_INVOKABLE void addPeer(const QString &peerId);
+    // Takes the peer out of the call at once and closes its connection in
+    // the background; peerClosed() follows when that is done. The call
+    // engine itself stays up. Returns false, and no peerClosed() follows,
+    // when the peer is not in the call (any more).
+    Q_INVOKABLE bool removePeer(const QString &peerId);
+    QStringList peerIds() const;
     Q_INVOKABLE void generateOfferSDP(const QString &peerId);
     Q_INVOKABLE void generateAnswerSDP(const QString &peerId);
     Q_INVOKABLE void addAudioTrack(const QString &peerId, const QString &trackName);
+    // One Opus packet to one peer, copied into a packet on the stack. The
+    // peer's RtpStream has a single sending thread: not while the send
+    // pipeline is running.
     Q_INVOKABLE void sendTrack(const QString &peerId, const QByteArray &buffer);
 
+    // Outgoing stream of a peer, or null before its track exists. Keep the
+    // handle instead of looking the peer up for every packet.
+    RtpStreamHandle stream(const QString &peerId) const;
+
+    // Sends a packet the caller owns to every connected peer: capacity
+    // bytes with the payload at RtpHeader::FixedSize. The payload is shared:
+    // each peer's own header is rewritten in front of it before that peer's
+    // send, so the cost per extra peer is a 12 byte header write.
+    // samplePosition is the frame's first sample on the 48 kHz capture clock
+    // and drives the RTP timestamp. For the encoder thread only.
+    void broadcastPacket(std::byte *packet, int capacity, int payloadSize, quint64 samplePosition, int frameSamples);
+    int connectedStreamCount() const;
+
+    // Received Opus frames go to the sink on the network thread instead of
+    // through incommingPacket. The sink must outlive the peer connections.
+    void setReceivedFrameSink(ReceivedFrameSink *sink) { m_receivedFrameSink.store(sink, std::memory_order_release); }
+
+    // Loss, jitter, RTT and counters from RTCP, in both directions.
+    PeerRtpStats peerStats(const QString &peerId) const;
+    // peerStats() of every peer as nested maps, keyed by peer ID, for QML.
+    QVariantMap callStats() const;
+    // Used for every peer connection created from now on, so a new call
+    // can run with different settings. Invalid settings are rejected.
+    bool setIceSettings(const IceSettings &settings);
+    IceSettings iceSettings() const;
+
+    // Peer connections kept ready for the next call, with the audio track
+    // added and, for the offerer, the offer made and candidates gathered.
+    // addPeer() takes one when it can and the pool refills in the
+    // background. Changing a setting that ends up in the SDP rebuilds it.
+    int peerPoolSize() const;
+    void setPeerPoolSize(int newPeerPoolSize);
+    void resetPeerPoolSize();
+
+    // Playout delay of the receive side; bounds how long a lost packet is
+    // worth NACKing.
+    void setPlayoutDelayMs(int delayMs);
+
     bool isOfferer() const;
     void setIsOfferer(bool newIsOfferer);
     void resetIsOfferer();
@@ -36,12 +99,35 @@ public:
     void setBitRate(int newBitRate);
     void resetBitRate();
 
+    bool inbandFec() const;
+    void setInbandFec(bool newInbandFec);
+    void resetInbandFec();
+
+    bool dtx() const;
+    void setDtx(bool newDtx);
+    void resetDtx();
+
+    // Everything the SDP's Opus fmtp line carries, at once: the pooled
+    // connections are rebuilt a single time, and not at all if nothing
+    // changed.
+    void setSdpSettings(int newBitRate, bool newInbandFec, bool newDtx);
+
+    // On by default: the SDP is signaled as soon as it exists and each local
+    // candidate follows through localCandidateGenerated. Off, offerIsReady
+    // and answerIsReady wait for gathering to complete and carry every
+    // candidate in the SDP.
+    bool trickleIce() const;
+    void setTrickleIce(bool newTrickleIce);
+    void resetTrickleIce();
+
 Q_SIGNALS:
     void openedDataChannel(const QString &peerId);
 
     void closedDataChannel(const QString &peerId);
 
-    void incommingPacket(const QString &peerId, const QByteArray &data, qint64 len);
+    // Only without a ReceivedFrameSink. sequenceNumber is extended to 32
+    // bits across wrap-arounds.
+    void incommingPacket(const QString &peerId, const QByteArray &data, qint64 len, quint32 sequenceNumber, quint32 timestamp);
 
     void localDescriptionGenerated(const QString &peerID, const QString &sdp);
 
@@ -61,43 +147,94 @@ Q_SIGNALS:
 
     void bitRateChanged();
 
+    void inbandFecChanged();
+
+    void dtxChanged();
+
+    void trickleIceChanged();
+
+    void peerPoolSizeChanged();
+
+    // A receiver report on our stream arrived; emitted on the network thread.
+    void networkFeedback(const QString &peerId, double fractionLost, int rttMs, int receiveRate);
+
+    // New statistics after every RTCP interval.
+    void callStatsChanged();
+
+    // A removed peer's connection is closed and released; emitted on the
+    // teardown thread.
+    void peerClosed(const QString &peerId);
+
 public Q_SLOTS:
     void setRemoteDescription(const QString &peerID, const QString &sdp);
     void setRemoteCandidate(const QString &peerID, const QString &candidate, const QString &sdpMid);
 
 private:
-    QByteArray readVariant(const rtc::message_variant &data);
+    void readRtpMessage(const QString &peerId, const rtc::message_variant &data, RtcpSession &session);
+    void sendRtcpReports();
     QString descriptionToJson(const rtc::Description &description);
-
-    inline uint32_t getCurrentTimestamp() {
-        using namespace std::chrono;
-        auto now = steady_clock::now();
-        auto ms = duration_cast<milliseconds>(now.time_since_epoch()).count();
-        return static_cast<uint32_t>(ms);
-    }
+    PeerContextHandle findPeer(const QString &peerId) const;
+    QMap<QString, PeerContextHandle> peers() const;
+    PeerContextHandle createPeer();
+    void addAudioTrack(const PeerContextHandle &peer, const QString &trackName);
+    PeerContextHandle takePooledPeer();
+    void fillPeerPool();
+    void resetPeerPool();
+    void closePeer(const PeerContextHandle &peer, const QString &peerId);
+    void scheduleGatheringTimeout(const QString &peerId, int timeoutMs);
+    void emitLocalDescription(const QString &peerId, const rtc::Description &description);
+    // Emits the description with the candidates gathered so far, once per peer.
+    void emitGatheredDescription(const QString &peerId, bool complete);
+    rtc::Configuration iceConfiguration() const;
+    void addRemoteCandidate(const std::shared_ptr<rtc::PeerConnection> &peerConnection, const QString &peerId,
+                            const rtc::Candidate &candidate);
+    std::string opusFormatParameters() const;
+    void setStreamConnected(const QString &peerId, bool connected);
 
 private:
-    static inline uint16_t                              m_sequenceNumber = 0;
-    static inline uint32_t                              m_instanceCounter = 0;
     bool                                                m_gatheringComplited = false;
     int                                                 m_bitRate = 48000;
     int                                                 m_payloadType = 111;
+    bool                                                m_inbandFec = false;
+    bool                                                m_dtx = false;
+    bool                                                m_trickleIce = true;
     rtc::Description::Audio                             m_audio;
-    rtc::SSRC                                           m_ssrc = 2;
+    rtc::SSRC                                           m_ssrc = 0;     // 0: random per stream
     bool                                                m_isOfferer = false;
     QString                                             m_localId;
-    rtc::Configuration                                  m_config;
+    IceSettings                                         m_iceSettings;
+    // Peers whose non-trickle description went out, by gathering or timeout.
+    QMutex                                              m_gatheredMutex;
+    QSet<QString>                                       m_gatheredPeers;
     QMap<QString, rtc::Description>                     m_peerSdps;
-    QMap<QString, std::shared_ptr<rtc::PeerConnection>> m_peerConnections;
-    QMap<QString, std::shared_ptr<rtc::Track>>          m_peerTracks;
+    // Written by signaling, read from libdatachannel callbacks and timers.
+    mutable QMutex                                      m_peersMutex;
+    QMap<QString, PeerContextHandle>                    m_peers;
+    QMap<QString, QList<rtc::Candidate>>                m_pendingCandidates;
+    QTimer                                             *m_rtcpTimer;
+    int                                                 m_playoutDelayMs = RtcpSession::DefaultPlayoutDelayMs;
+    int                                                 m_peerPoolSize = 1;
+    QMutex                                              m_peerPoolMutex;
+    QList<PeerContextHandle>                            m_peerPool;
+    QThreadPool                                         m_teardownPool;
+    std::atomic<ReceivedFrameSink *>                    m_receivedFrameSink{nullptr};
     QString                                             m_localDescription;
     QString                                             m_remoteDescription;
+    // Copy-on-write list for the encoder thread, replaced under the mutex
+    // whenever a peer connects or goes away.
+    QMutex                                              m_connectedStreamsMutex;
+    std::shared_ptr<const std::vector<RtpStreamHandle>> m_connectedStreams;
 
 
     Q_PROPERTY(bool isOfferer READ isOfferer WRITE setIsOfferer RESET resetIsOfferer NOTIFY isOffererChanged FINAL)
     Q_PROPERTY(rtc::SSRC ssrc READ ssrc WRITE setSsrc RESET resetSsrc NOTIFY ssrcChanged FINAL)
     Q_PROPERTY(int payloadType READ payloadType WRITE setPayloadType RESET resetPayloadType NOTIFY payloadTypeChanged FINAL)
     Q_PROPERTY(int bitRate READ bitRate WRITE setBitRate RESET resetBitRate NOTIFY bitRateChanged FINAL)
+    Q_PROPERTY(bool inbandFec READ inbandFec WRITE setInbandFec RESET resetInbandFec NOTIFY inbandFecChanged FINAL)
+    Q_PROPERTY(bool dtx READ dtx WRITE setDtx RESET resetDtx NOTIFY dtxChanged FINAL)
+    Q_PROPERTY(bool trickleIce READ trickleIce WRITE setTrickleIce RESET resetTrickleIce NOTIFY trickleIceChanged FINAL)
+    Q_PROPERTY(int peerPoolSize READ peerPoolSize WRITE setPeerPoolSize RESET resetPeerPoolSize NOTIFY peerPoolSizeChanged FINAL)
+    Q_PROPERTY(QVariantMap callStats READ callStats NOTIFY callStatsChanged FINAL)
 };
 
 #endif
@@ -0,0 +1,158 @@
+#ifndef MEDIAFRAME_H
+#define MEDIAFRAME_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class FramePool;
+
+/**
+ * One buffer of media passed between pipeline stages: PCM samples
+ * (MediaFrame<qint16>) or an encoded packet (MediaFrame<unsigned char>).
+ * Frames live in a FramePool and are only handed around through FrameRef,
+ * so a stage that wants to keep one (a recorder, a mixer input) holds a
+ * reference instead of copying. headroom() is reserved space in front of
+ * data() for a header written in place, such as the RTP header.
+ */
+template <typename T>
+class MediaFrame
+{
+public:
+    T *data() { return reinterpret_cast<T *>(m_storage.data() + m_headroomSize); }
+    const T *data() const { return reinterpret_cast<const T *>(m_storage.data() + m_headroomSize); }
+
+    // In elements of T, not bytes.
+    int size() const { return m_size; }
+    void setSize(int size) { m_size = size; }
+    int capacity() const { return m_capacity; }
+
+    unsigned char *headroom() { return m_storage.data(); }
+    int headroomSize() const { return m_headroomSize; }
+
+    quint64 samplePosition = 0;     // first sample on the capture clock
+    int frameSamples = 0;           // samples per channel
+    qint64 captureUs = 0;           // PipelineStage::clockNs() / 1000 when captured
+
+private:
+    friend class FramePool<T>;
+    template <typename>
+    friend class FrameRef;
+
+    void clear()
+    {
+        m_size = 0;
+        samplePosition = 0;
+        frameSamples = 0;
+        captureUs = 0;
+    }
+
+    std::vector<unsigned char>  m_storage;
+    int                         m_headroomSize = 0;
+    int                         m_capacity = 0;
+    int                         m_size = 0;
+    std::atomic<int>            m_refs{0};
+};
+
+/**
+ * Counted reference to a pooled MediaFrame. Copies share the frame; when
+ * the last reference goes away the frame is free for the pool again. Never
+ * allocates.
+ */
+template <typename T>
+class FrameRef
+{
+public:
+    FrameRef() = default;
+    FrameRef(const FrameRef &other) : m_frame(other.m_frame)
+    {
+        if (m_frame)
+            m_frame->m_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    FrameRef(FrameRef &&other) noexcept : m_frame(std::exchange(other.m_frame, nullptr)) {}
+    ~FrameRef() { release(); }
+
+    FrameRef &operator=(FrameRef other) noexcept
+    {
+        std::swap(m_frame, other.m_frame);
+        return *this;
+    }
+
+    MediaFrame<T> *get() const { return m_frame; }
+    MediaFrame<T> *operator->() const { return m_frame; }
+    MediaFrame<T> &operator*() const { return *m_frame; }
+    explicit operator bool() const { return m_frame != nullptr; }
+
+    // Other references to the same frame exist; do not write into it.
+    bool isShared() const { return m_frame && m_frame->m_refs.load(std::memory_order_acquire) > 1; }
+
+private:
+    friend class FramePool<T>;
+    explicit FrameRef(MediaFrame<T> *frame) : m_frame(frame) {}
+
+    void release()
+    {
+        if (m_frame)
+            m_frame->m_refs.fetch_sub(1, std::memory_order_release);
+        m_frame = nullptr;
+    }
+
+    MediaFrame<T> *m_frame = nullptr;
+};
+
+/**
+ * Fixed set of frames allocated up front. acquire() claims a free frame
+ * without locking and can be called from any thread; it returns an empty
+ * FrameRef when every frame is still referenced, which the caller treats
+ * like an overrun. The pool must outlive every FrameRef it handed out.
+ */
+template <typename T>
+class FramePool
+{
+public:
+    FramePool(int frameCount, int frameCapacity, int headroomSize = 0)
+        : m_frames(new MediaFrame<T>[frameCount]),
+        m_frameCount(frameCount)
+    {
+        Q_ASSERT(headroomSize % int(alignof(T)) == 0);
+        for (int i = 0; i < frameCount; ++i) {
+            MediaFrame<T> &frame = m_frames[i];
+            frame.m_storage.resize(std::size_t(headroomSize) + std::size_t(frameCapacity) * sizeof(T));
+            frame.m_headroomSize = headroomSize;
+            frame.m_capacity = frameCapacity;
+        }
+    }
+
+    FrameRef<T> acquire()
+    {
+        const unsigned start = m_next.fetch_add(1, std::memory_order_relaxed);
+        for (int i = 0; i < m_frameCount; ++i) {
+            MediaFrame<T> &frame = m_frames[(start + unsigned(i)) % unsigned(m_frameCount)];
+            int refs = 0;
+            if (frame.m_refs.compare_exchange_strong(refs, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                frame.clear();
+                return FrameRef<T>(&frame);
+            }
+        }
+        m_exhausted.fetch_add(1, std::memory_order_relaxed);
+        return FrameRef<T>();
+    }
+
+    int frameCount() const { return m_frameCount; }
+    // acquire() calls that found no free frame.
+    quint64 exhausted() const { return m_exhausted.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<MediaFrame<T>[]>    m_frames;
+    int                                 m_frameCount;
+    std::atomic<unsigned>               m_next{0};
+    std::atomic<quint64>                m_exhausted{0};
+};
+
+using PcmFrame = MediaFrame<qint16>;
+using EncodedFrame = MediaFrame<unsigned char>;
+
+#endif
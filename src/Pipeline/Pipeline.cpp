@@ -0,0 +1,39 @@
+#include "Pipeline.h"
+
+void Pipeline::addStage(PipelineStage *stage)
+{
+    if (stage && !m_stages.contains(stage)) {
+        m_stages.append(stage);
+    }
+}
+
+QList<StageTiming> Pipeline::timings() const
+{
+    QList<StageTiming> result;
+    for (const PipelineStage *stage : m_stages) {
+        result.append(stage->timing());
+    }
+    return result;
+}
+
+QVariantMap Pipeline::timingStats() const
+{
+    QVariantMap result;
+    for (const PipelineStage *stage : m_stages) {
+        const StageTiming timing = stage->timing();
+
+        QVariantMap entry;
+        entry["frames"] = timing.frames;
+        entry["averageUs"] = timing.averageUs();
+        entry["maxUs"] = double(timing.maxNs) / 1000.0;
+        result[timing.name] = entry;
+    }
+    return result;
+}
+
+void Pipeline::resetTimings()
+{
+    for (PipelineStage *stage : m_stages) {
+        stage->resetTiming();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <QList>
+#include <QVariantMap>
+#include "Pipeline/PipelinePort.h"
+#include "Pipeline/PipelineStage.h"
+
+/**
+ * A chain of stages, for linking them and reading their timings in one
+ * place. The stages belong to whoever created them and must outlive the
+ * pipeline's use of them.
+ */
+class Pipeline
+{
+public:
+    void addStage(PipelineStage *stage);
+
+    template <typename T>
+    void link(OutputPort<T> &output, InputPort<T> &input)
+    {
+        output.connect(input);
+        addStage(input.stage());
+    }
+
+    QList<PipelineStage *> stages() const { return m_stages; }
+    QList<StageTiming> timings() const;
+    // timings() as nested maps keyed by stage name, for QML and logs.
+    QVariantMap timingStats() const;
+    void resetTimings();
+
+private:
+    QList<PipelineStage *> m_stages;
+};
+
+#endif
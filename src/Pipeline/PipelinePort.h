@@ -0,0 +1,59 @@
+#ifndef PIPELINEPORT_H
+#define PIPELINEPORT_H
+
+#include <functional>
+#include <vector>
+#include "Pipeline/MediaFrame.h"
+#include "Pipeline/PipelineStage.h"
+
+/**
+ * Entry of a stage for frames of type MediaFrame<T>. Every received frame
+ * is passed to the stage's handler on the caller's thread and timed as
+ * one frame of that stage. The handler only borrows the reference; it
+ * copies the FrameRef if it keeps the frame.
+ */
+template <typename T>
+class InputPort
+{
+public:
+    using Handler = std::function<void(const FrameRef<T> &)>;
+
+    InputPort(PipelineStage *stage, Handler handler) : m_stage(stage), m_handler(std::move(handler)) {}
+
+    void receive(const FrameRef<T> &frame)
+    {
+        m_stage->run([&] { m_handler(frame); });
+    }
+
+    PipelineStage *stage() const { return m_stage; }
+
+private:
+    PipelineStage  *m_stage;
+    Handler         m_handler;
+};
+
+/**
+ * Exit of a stage. An output can feed several inputs (say the network
+ * sender and a recorder); all of them get the same frame, none a copy.
+ * Only an input of the same frame type can be connected. Connect before
+ * frames flow: push() does not lock.
+ */
+template <typename T>
+class OutputPort
+{
+public:
+    void connect(InputPort<T> &input) { m_inputs.push_back(&input); }
+    void disconnectAll() { m_inputs.clear(); }
+    bool isConnected() const { return !m_inputs.empty(); }
+
+    void push(const FrameRef<T> &frame) const
+    {
+        for (InputPort<T> *input : m_inputs)
+            input->receive(frame);
+    }
+
+private:
+    std::vector<InputPort<T> *> m_inputs;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "PipelineStage.h"
+#include <chrono>
+
+// Time the stages called from the current stage spent, on this thread.
+static thread_local qint64 t_childNs = 0;
+
+StageTiming PipelineStage::timing() const
+{
+    StageTiming timing;
+    timing.name = m_name;
+    timing.frames = m_frames.load(std::memory_order_relaxed);
+    timing.totalNs = m_totalNs.load(std::memory_order_relaxed);
+    timing.maxNs = m_maxNs.load(std::memory_order_relaxed);
+    return timing;
+}
+
+void PipelineStage::resetTiming()
+{
+    m_frames.store(0, std::memory_order_relaxed);
+    m_totalNs.store(0, std::memory_order_relaxed);
+    m_maxNs.store(0, std::memory_order_relaxed);
+}
+
+qint64 PipelineStage::clockNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+PipelineStage::Scope PipelineStage::beginTiming()
+{
+    const Scope scope{clockNs(), t_childNs};
+    t_childNs = 0;
+    return scope;
+}
+
+void PipelineStage::endTiming(const Scope &scope)
+{
+    const qint64 elapsedNs = clockNs() - scope.startNs;
+    const qint64 ownNs = elapsedNs - t_childNs;
+    // To the enclosing stage, all of this was downstream time.
+    t_childNs = scope.outerChildNs + elapsedNs;
+
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+    m_totalNs.fetch_add(ownNs, std::memory_order_relaxed);
+    qint64 maxNs = m_maxNs.load(std::memory_order_relaxed);
+    while (ownNs > maxNs && !m_maxNs.compare_exchange_weak(maxNs, ownNs, std::memory_order_relaxed)) {
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PIPELINESTAGE_H
+#define PIPELINESTAGE_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// Time spent in one stage, excluding the stages it pushed frames into.
+struct StageTiming
+{
+    QString name;
+    quint64 frames = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+
+    double averageUs() const { return frames ? double(totalNs) / double(frames) / 1000.0 : 0.0; }
+};
+
+/**
+ * Base of every pipeline step. Frames move between stages through typed
+ * ports (see PipelinePort.h) by direct calls on the pushing thread, so a
+ * chain adds neither copies nor event loop hops. Each stage records the
+ * time of its own work: what a downstream stage spends on a pushed frame
+ * is charged to that stage, not to the one that pushed it.
+ */
+class PipelineStage
+{
+public:
+    explicit PipelineStage(const QString &name) : m_name(name) {}
+    virtual ~PipelineStage() = default;
+
+    PipelineStage(const PipelineStage &) = delete;
+    PipelineStage &operator=(const PipelineStage &) = delete;
+
+    const QString &stageName() const { return m_name; }
+
+    // Runs work as one frame of this stage. Input ports call it for every
+    // frame they receive; sources call it around producing a frame.
+    template <typename Work>
+    void run(Work &&work)
+    {
+        const Scope scope = beginTiming();
+        work();
+        endTiming(scope);
+    }
+
+    StageTiming timing() const;
+    void resetTiming();
+
+    // Monotonic clock for stage timing and frame capture times.
+    static qint64 clockNs();
+
+private:
+    struct Scope
+    {
+        qint64 startNs;
+        qint64 outerChildNs;
+    };
+
+    Scope beginTiming();
+    void endTiming(const Scope &scope);
+
+    QString                 m_name;
+    std::atomic<quint64>    m_frames{0};
+    std::atomic<qint64>     m_totalNs{0};
+    std::atomic<qint64>     m_maxNs{0};
+};
+
+#endif
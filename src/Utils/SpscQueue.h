@@ -0,0 +1,58 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Bounded lock-free single-producer/single-consumer queue of fixed,
+ * preallocated slots. Elements are filled and read in place, so large
+ * slots (packet buffers) are never copied by the queue and nothing is
+ * allocated after construction.
+ *
+ * Producer: T *slot = beginPush(); ...fill...; endPush();
+ * Consumer: while (const T *slot = front()) { ...use...; pop(); }
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    // Producer side. Returns nullptr when the queue is full.
+    T *beginPush()
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+            return nullptr;
+        return &m_slots[head & (Capacity - 1)];
+    }
+
+    void endPush() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer side. Returns nullptr when the queue is empty.
+    T *front()
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_slots[tail & (Capacity - 1)];
+    }
+
+    void pop() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    std::size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity>             m_slots;
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Lock-free single-producer/single-consumer ring of trivially copyable
+ * elements. Exactly one thread may call write() and exactly one other thread
+ * may call read(); neither side ever blocks or allocates. reset() is not
+ * thread safe and must only be called while both sides are idle.
+ */
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(std::size_t capacity = 0) { reset(capacity); }
+
+    void reset(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        m_buffer.assign(size, T());
+        m_mask = size - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const { return m_buffer.size(); }
+
+    std::size_t readAvailable() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t writeAvailable() const { return capacity() - readAvailable(); }
+
+    // Producer side. Returns the number of elements stored, which is less
+    // than count when the ring is full.
+    std::size_t write(const T *data, std::size_t count)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        const std::size_t tail = m_tail.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (head - tail));
+
+        const std::size_t offset = head & m_mask;
+        const std::size_t first = std::min(count, capacity() - offset);
+        std::copy_n(data, first, m_buffer.begin() + offset);
+        std::copy_n(data + first, count - first, m_buffer.begin());
+
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Returns the number of elements copied out.
+    std::size_t read(T *data, std::size_t count)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t head = m_head.load(std::memory_order_acquire);
+        count = std::min(count, head - tail);
+
+        const std::size_t offset = tail & m_mask;
+        const std::size_t first = std::min(count, capacity() - offset);
+        std::copy_n(m_buffer.begin() + offset, first, data);
+        std::copy_n(m_buffer.begin(), count - first, data + first);
+
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Drops up to count elements without reading them.
+    std::size_t discard(std::size_t count)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        count = std::min(count, m_head.load(std::memory_order_acquire) - tail);
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<T>                      m_buffer;
+    std::size_t                         m_mask = 0;
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+#endif
@@ -0,0 +1,83 @@
+# Third-party dependencies (Opus, libdatachannel, OpenSSL, socket.io-client-cpp),
+# shared by the application and the benchmarks in Bench/.
+
+#windows configuration
+win32: PATH_TO_OPUS = "F:/Program Files (x86)/MMD.Soor/University/Term 7/CN/CAs/Lib/opus"
+win32: PATH_TO_LIBDATACHANNEL = "F:/Program Files (x86)/MMD.Soor/University/Term 7/CN/CAs/Lib/libdatachannel"
+win32: PATH_TO_SIO = "F:/Program Files (x86)/MMD.Soor/University/Term 7/CN/CAs/Lib/socket.io-client-cpp"
+
+win32: INCLUDEPATH += $$PATH_TO_LIBDATACHANNEL/include
+win32: LIBS += -L$$PATH_TO_LIBDATACHANNEL/Windows/Mingw64 -ldatachannel.dll
+
+win32: LIBS += -LE:/Qt/Tools/OpenSSLv3/Win_x64/bin -lcrypto-3-x64 -lssl-3-x64
+win32: INCLUDEPATH += E:/Qt/Tools/OpenSSLv3/Win_x64/include
+
+
+win32: INCLUDEPATH += $$PATH_TO_OPUS/include
+win32: LIBS += -L$$PATH_TO_OPUS/Windows/Mingw64 -lopus
+
+win32: LIBS += -lws2_32
+win32: LIBS += -lssp
+
+win32: INCLUDEPATH += $$PATH_TO_SIO/lib/websocketpp
+win32: INCLUDEPATH += $$PATH_TO_SIO/lib/asio/asio/include
+win32: INCLUDEPATH += $$PATH_TO_SIO/lib/rapidjson/include
+
+
+win32: DEFINES += ASIO_STANDALONE
+win32: DEFINES += _WEBSOCKETPP_CPP11_STL_
+win32: DEFINES += _WEBSOCKETPP_CPP11_FUNCTIONAL_
+win32: DEFINES += SIO_TLS
+
+#macOS configuration
+macx: PATH_TO_LIBDATACHANNEL = "/Users/amirparsamobed/Documents/University/Term 7/Computer Network/Github Repositories/CN_CA1_lib/libdatachannel"
+macx: PATH_TO_SIO = "/Users/amirparsamobed/Documents/University/Term 7/Computer Network/Github Repositories/CN_CA1_lib/socket.io-client-cpp"
+
+macx: INCLUDEPATH += $$PATH_TO_LIBDATACHANNEL/include
+macx: LIBS += -L$$PATH_TO_LIBDATACHANNEL/build -ldatachannel
+
+macx: LIBS += -L/opt/homebrew/opt/openssl/lib -lssl -lcrypto
+macx: INCLUDEPATH += /opt/homebrew/opt/openssl/include
+
+macx: INCLUDEPATH += /usr/local/include/opus
+macx: LIBS += -L/usr/local/lib -lopus
+
+macx: LIBS += -lpthread
+
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/websocketpp
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/asio/asio/include
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/rapidjson/include
+
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/websocketpp
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/asio/asio/include
+macx: INCLUDEPATH += $$PATH_TO_SIO/lib/rapidjson/include
+
+macx: DEFINES += ASIO_STANDALONE
+macx: DEFINES += _WEBSOCKETPP_CPP11_STL_
+macx: DEFINES += _WEBSOCKETPP_CPP11_FUNCTIONAL_
+macx: DEFINES += SIO_TLS
+
+#Linux configuration: Opus and OpenSSL through pkg-config, libdatachannel
+#from the default library path (or LIBDATACHANNEL_DIR) and the header-only
+#socket.io dependencies from a socket.io-client-cpp checkout (SIO_DIR).
+unix:!macx: PATH_TO_LIBDATACHANNEL = $$(LIBDATACHANNEL_DIR)
+unix:!macx: PATH_TO_SIO = $$(SIO_DIR)
+unix:!macx: isEmpty(PATH_TO_SIO): PATH_TO_SIO = /usr/local/src/socket.io-client-cpp
+
+unix:!macx: CONFIG += link_pkgconfig
+unix:!macx: PKGCONFIG += opus openssl
+
+unix:!macx: !isEmpty(PATH_TO_LIBDATACHANNEL): INCLUDEPATH += $$PATH_TO_LIBDATACHANNEL/include
+unix:!macx: !isEmpty(PATH_TO_LIBDATACHANNEL): LIBS += -L$$PATH_TO_LIBDATACHANNEL/build
+unix:!macx: LIBS += -ldatachannel
+
+unix:!macx: LIBS += -lpthread
+
+unix:!macx: INCLUDEPATH += $$PATH_TO_SIO/lib/websocketpp
+unix:!macx: INCLUDEPATH += $$PATH_TO_SIO/lib/asio/asio/include
+unix:!macx: INCLUDEPATH += $$PATH_TO_SIO/lib/rapidjson/include
+
+unix:!macx: DEFINES += ASIO_STANDALONE
+unix:!macx: DEFINES += _WEBSOCKETPP_CPP11_STL_
+unix:!macx: DEFINES += _WEBSOCKETPP_CPP11_FUNCTIONAL_
+unix:!macx: DEFINES += SIO_TLS
@@ -0,0 +1,75 @@
+# Call engine: audio, pipeline, WebRTC and signaling, without any UI. Used
+# by the QML application (src.pro) and the headless one (Headless/).
+
+QT += core multimedia
+CONFIG += c++17 no_keywords
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/Audio/AudioInput.cpp \
+    $$PWD/Audio/AudioOutput.cpp \
+    $$PWD/Audio/DeviceEndpoint.cpp \
+    $$PWD/Audio/FileCapture.cpp \
+    $$PWD/Audio/FilePlayback.cpp \
+    $$PWD/Audio/JitterBuffer.cpp \
+    $$PWD/Audio/OpusEncoderStage.cpp \
+    $$PWD/Audio/PlayoutDevice.cpp \
+    $$PWD/Audio/PlayoutStream.cpp \
+    $$PWD/Network/BitrateController.cpp \
+    $$PWD/Network/RtcpPacket.cpp \
+    $$PWD/Network/RtcpSession.cpp \
+    $$PWD/Network/RtpPacket.cpp \
+    $$PWD/Network/RtpRetransmissionCache.cpp \
+    $$PWD/Network/RtpSenderStage.cpp \
+    $$PWD/Network/RtpStream.cpp \
+    $$PWD/Network/Client.cpp \
+    $$PWD/Network/webrtc.cpp \
+    $$PWD/Pipeline/Pipeline.cpp \
+    $$PWD/Pipeline/PipelineStage.cpp \
+    $$PWD/SocketIO/internal/sio_client_impl.cpp \
+    $$PWD/SocketIO/internal/sio_packet.cpp \
+    $$PWD/SocketIO/sio_client.cpp \
+    $$PWD/SocketIO/sio_socket.cpp
+
+HEADERS += \
+    $$PWD/Audio/AudioEndpoint.h \
+    $$PWD/Audio/AudioInput.h \
+    $$PWD/Audio/AudioOutput.h \
+    $$PWD/Audio/DeviceEndpoint.h \
+    $$PWD/Audio/EncoderProfile.h \
+    $$PWD/Audio/FileCapture.h \
+    $$PWD/Audio/FilePlayback.h \
+    $$PWD/Audio/JitterBuffer.h \
+    $$PWD/Audio/OpusEncoderStage.h \
+    $$PWD/Audio/PlayoutDevice.h \
+    $$PWD/Audio/PlayoutStream.h \
+    $$PWD/Audio/ReceivedFrameSink.h \
+    $$PWD/Audio/ReceiveQueue.h \
+    $$PWD/Network/BitrateController.h \
+    $$PWD/Network/IceSettings.h \
+    $$PWD/Network/PeerContext.h \
+    $$PWD/Network/RtcpPacket.h \
+    $$PWD/Network/RtcpSession.h \
+    $$PWD/Network/RtpPacket.h \
+    $$PWD/Network/RtpRetransmissionCache.h \
+    $$PWD/Network/RtpSenderStage.h \
+    $$PWD/Network/RtpStream.h \
+    $$PWD/Network/Client.h \
+    $$PWD/Network/webrtc.h \
+    $$PWD/Pipeline/MediaFrame.h \
+    $$PWD/Pipeline/Pipeline.h \
+    $$PWD/Pipeline/PipelinePort.h \
+    $$PWD/Pipeline/PipelineStage.h \
+    $$PWD/SocketIO/internal/sio_client_impl.h \
+    $$PWD/SocketIO/internal/sio_packet.h \
+    $$PWD/SocketIO/sio_client.h \
+    $$PWD/SocketIO/sio_message.h \
+    $$PWD/SocketIO/sio_socket.h \
+    $$PWD/Utils/SpscQueue.h \
+    $$PWD/Utils/SpscRingBuffer.h
+
+#Libs
+include($$PWD/deps.pri)
+
+QMAKE_CXXFLAGS += -fstack-protector
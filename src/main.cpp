@@ -7,7 +7,8 @@ int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
 
-    bool isOfferer = stoi(argv[1]);
+    // Answerer unless started with "1"; Headless/ has the full set of options.
+    bool isOfferer = argc > 1 && stoi(argv[1]);
 
     QString qmlPath;
 